@@ -0,0 +1,52 @@
+#ifndef AES256CTR_H
+#define AES256CTR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+#include "poly.h"
+#include "polyvec.h"
+
+/*
+  Self-contained AES-256-CTR keystream on AES-NI, eight blocks in
+  flight per loop, for the AES flavour of the mask expansion
+  (TEMPO_VECTOR_ALG=2) without going through OpenSSL EVP, and a
+  portable T-table AES with the same output on other CPUs or with
+  PAKE_NO_AESNI. The counter block is nonce(12 bytes)||ctr(32-bit
+  big-endian, from 0), as in the Kyber-90s XOF; output is squeezed
+  in 64-byte blocks.
+*/
+
+#define AES256CTR_BLOCKBYTES 64
+
+typedef struct {
+  uint8_t rkeys[15][16] __attribute__((aligned(16)));
+  uint8_t nonce[12];
+  uint32_t ctr;
+} aes256ctr_ctx;
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(PAKE_NO_AESNI)
+#define AES256CTR_NI 1
+#endif
+
+/* non-zero iff the AES-NI code is used (cached) */
+int aes256ctr_available(void);
+
+void aes256ctr_init(aes256ctr_ctx *ctx,
+                    const uint8_t key[32],
+                    const uint8_t nonce[12]);
+void aes256ctr_squeezeblocks(uint8_t *out, size_t nblocks,
+                             aes256ctr_ctx *ctx);
+
+/*
+  gen_vector with polynomial i rejection-sampled from the keystream
+  under key = seed and nonce = i||0xFF||0^10.
+*/
+void gen_vector_aes256ctr(polyvec *a, const uint8_t seed[KYBER_SYMBYTES]);
+
+/* polynomial i of gen_vector_aes256ctr on its own */
+void gen_vector_poly_aes256ctr(poly *r,
+                               const uint8_t seed[KYBER_SYMBYTES],
+                               unsigned int i);
+
+#endif
@@ -2,10 +2,13 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "params.h"
+#include "genx4.h"
+#include "polymask.h"
 #include "hic.h"
 #include "polyvec.h"
 #include "rej_uniform.h"
 #include "symmetric.h"
+#include "sha3inc.h"
 
 #include <inttypes.h>
 
@@ -14,23 +17,220 @@
  * **********************************************/
 
 #include "rijndael256/rijndael.h"
+#include "rijndael256/rijndael_ni.h"
+#include "rijndael256/rijndael_bs.h"
 int ic256_enc(uint8_t block[KYBER_SYMBYTES], uint8_t key[KYBER_SYMBYTES]);
 int ic256_dec(uint8_t block[KYBER_SYMBYTES], uint8_t key[KYBER_SYMBYTES]);
+int ic256_enc_xN(uint8_t (*block)[KYBER_SYMBYTES],
+                 const uint8_t (*key)[KYBER_SYMBYTES], size_t n);
+int ic256_dec_xN(uint8_t (*block)[KYBER_SYMBYTES],
+                 const uint8_t (*key)[KYBER_SYMBYTES], size_t n);
 
+// AES-NI when the CPU has it, specialized 256/256 tables otherwise.
+// Encryption derives the round keys on the fly; decryption keeps the
+// stored schedule, since stepping the expansion backwards from the
+// last round key would run it twice.
 int ic256_enc(uint8_t block[KYBER_SYMBYTES], uint8_t key[KYBER_SYMBYTES]) {
-  roundkey rkk;
-  xrijndaelKeySched((xword32 *)key, 256, 256, &rkk);
-  xrijndaelEncrypt((xword32 *)block, &rkk);
+#ifdef RIJNDAEL_NI
+  if(xrijndael256niAvailable()) {
+    xrijndael256niEncryptKey((xword32 *)block, (xword32 *)key);
+    return 0;
+  }
+#endif
+  xrijndael256EncryptKey((xword32 *)block, (xword32 *)key);
   return 0;
 }
 
 int ic256_dec(uint8_t block[KYBER_SYMBYTES], uint8_t key[KYBER_SYMBYTES]) {
   roundkey rkk;
-  xrijndaelKeySched((xword32 *)key, 256, 256, &rkk);
-  xrijndaelDecrypt((xword32 *)block, &rkk);
+#ifdef RIJNDAEL_NI
+  if(xrijndael256niAvailable()) {
+    xrijndael256niKeySched((xword32 *)key, rkk.rk);
+    xrijndael256niDecKeySched(rkk.rk, rkk.rk);
+    xrijndael256niDecrypt((xword32 *)block, rkk.rk);
+    return 0;
+  }
+#endif
+  xrijndael256KeySched((xword32 *)key, rkk.rk);
+  xrijndael256DecKeySched(rkk.rk, rkk.rk);
+  xrijndael256Decrypt((xword32 *)block, rkk.rk);
+  return 0;
+}
+
+// n independent (key, block) pairs, XRIJNDAEL_BS_LANES at a time with
+// the bitsliced (constant-time) cipher; one block at a time otherwise
+static int ic256_xN(uint8_t (*block)[KYBER_SYMBYTES],
+                    const uint8_t (*key)[KYBER_SYMBYTES], size_t n, int dec) {
+  xword8 b[XRIJNDAEL_BS_LANES][32];
+  xword8 k[XRIJNDAEL_BS_LANES][32];
+  size_t i, l, m;
+
+  for(i=0;i<n;i+=m) {
+    m = n-i < XRIJNDAEL_BS_LANES ? n-i : XRIJNDAEL_BS_LANES;
+    // unused lanes repeat the first pair of the chunk
+    for(l=0;l<XRIJNDAEL_BS_LANES;l++) {
+      memcpy(b[l],block[i+(l<m?l:0)],KYBER_SYMBYTES);
+      memcpy(k[l],key[i+(l<m?l:0)],KYBER_SYMBYTES);
+    }
+#ifdef RIJNDAEL_BS
+    if(xrijndael256bsAvailable()) {
+      if(dec)
+        xrijndael256bsDecrypt(b,(const xword8 (*)[32])k);
+      else
+        xrijndael256bsEncrypt(b,(const xword8 (*)[32])k);
+    } else
+#endif
+    for(l=0;l<m;l++) {
+      if(dec)
+        ic256_dec(b[l],k[l]);
+      else
+        ic256_enc(b[l],k[l]);
+    }
+    for(l=0;l<m;l++)
+      memcpy(block[i+l],b[l],KYBER_SYMBYTES);
+  }
   return 0;
 }
 
+int ic256_enc_xN(uint8_t (*block)[KYBER_SYMBYTES],
+                 const uint8_t (*key)[KYBER_SYMBYTES], size_t n) {
+  return ic256_xN(block,key,n,0);
+}
+
+int ic256_dec_xN(uint8_t (*block)[KYBER_SYMBYTES],
+                 const uint8_t (*key)[KYBER_SYMBYTES], size_t n) {
+  return ic256_xN(block,key,n,1);
+}
+
+
+// H(pw || sid || rho) -> mask_seed_t
+static void hic_mask_seed(uint8_t mask_seed_t[KYBER_SYMBYTES],
+                          const uint8_t rho[KYBER_SYMBYTES],
+                          const uint8_t pw[KYBER_SYMBYTES],
+                          const uint8_t sid[KYBER_SYMBYTES])
+{
+  keccak_state state;
+
+  mask_hash_h_init(&state);
+  mask_hash_h_absorb(&state,pw,KYBER_SYMBYTES);
+  mask_hash_h_absorb(&state,sid,KYBER_SYMBYTES);
+  mask_hash_h_absorb(&state,rho,KYBER_SYMBYTES);
+  mask_hash_h_final(mask_seed_t,&state);
+}
+
+// starts G(pw || sid || vecpart) -> key, vecpart is absorbed by the caller
+static void hic_key_init(keccak_state *state,
+                         const uint8_t pw[KYBER_SYMBYTES],
+                         const uint8_t sid[KYBER_SYMBYTES])
+{
+  mask_hash_h_init(state);
+  mask_hash_h_absorb(state,pw,KYBER_SYMBYTES);
+  mask_hash_h_absorb(state,sid,KYBER_SYMBYTES);
+}
+
+// G(pw || sid || vecpart) -> key, straight from the packed vector
+static void hic_key(uint8_t key[KYBER_SYMBYTES],
+                    const uint8_t vec[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                    const uint8_t pw[KYBER_SYMBYTES],
+                    const uint8_t sid[KYBER_SYMBYTES])
+{
+  keccak_state state;
+
+  hic_key_init(&state,pw,sid);
+  mask_hash_h_absorb(&state,vec,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+  mask_hash_h_final(key,&state);
+}
+
+// hic_key for m <= HIC_BATCH inputs, four at a time on the four-lane
+// Keccak; unused lanes of a group hash its first input again, and a
+// group of one takes the single-state hash
+static void hic_key_xN(uint8_t (*key)[KYBER_SYMBYTES],
+                       const uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                       const uint8_t (*pw)[KYBER_SYMBYTES],
+                       const uint8_t (*sid)[KYBER_SYMBYTES],
+                       size_t m)
+{
+  uint8_t scratch[KYBER_SYMBYTES];
+  const uint8_t *in_pw[4], *in_sid[4], *in_vec[4];
+  uint8_t *out[4];
+  keccakx4_state state;
+  size_t i, j;
+  unsigned int l, k;
+
+  for(i=0;i<m;i+=k) {
+    k = m-i < 4 ? m-i : 4;
+    if(k == 1) {
+      hic_key(key[i],icc[i],pw[i],sid[i]);
+      continue;
+    }
+    for(l=0;l<4;l++) {
+      j = i + (l < k ? l : 0);
+      in_pw[l] = pw[j];
+      in_sid[l] = sid[j];
+      in_vec[l] = icc[j];
+      out[l] = l < k ? key[i+l] : scratch;
+    }
+    mask_hash_hx4_init(&state);
+    mask_hash_hx4_absorb(&state,in_pw,KYBER_SYMBYTES);
+    mask_hash_hx4_absorb(&state,in_sid,KYBER_SYMBYTES);
+    mask_hash_hx4_absorb(&state,in_vec,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+    mask_hash_hx4_final(out,&state);
+  }
+}
+
+// everything in hic_eval before the ideal cipher: writes the masked
+// vector part of icc and returns the cipher key and (plain) rho
+static void hic_eval_pre(uint8_t icc[KYBER_PUBLICKEYBYTES],
+                         uint8_t key[KYBER_SYMBYTES],
+                         uint8_t rho[KYBER_SYMBYTES],
+                         const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                         const uint8_t pw[KYBER_SYMBYTES],
+                         const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t mask_seed_t[KYBER_SYMBYTES];
+  polyvec mask_t;
+  keccak_state state;
+  unsigned int i;
+
+  //unpack seed part of pk
+  memcpy(rho,pk+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,KYBER_SYMBYTES);
+
+  hic_mask_seed(mask_seed_t,rho,pw,sid);
+
+  // H'(mask_seed_t) -> mask_t
+  pake_gen_vector(&mask_t,mask_seed_t); 
+
+  // mask vec part of pk, hashing each polynomial while it is still
+  // in cache
+  hic_key_init(&state,pw,sid);
+  for(i=0;i<KYBER_K;i++) {
+    poly_mask_add(icc+i*KYBER_POLYBYTES, pk+i*KYBER_POLYBYTES, &mask_t.vec[i]);
+    mask_hash_h_absorb(&state,icc+i*KYBER_POLYBYTES,KYBER_POLYBYTES);
+  }
+  mask_hash_h_final(key,&state);
+}
+
+// everything in hic_inv after the ideal cipher: unmasks the vector
+// part of icc with the decrypted rho, leaving it in pkpv as well
+static void hic_inv_post(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                         polyvec *pkpv,
+                         const uint8_t icc[KYBER_PUBLICKEYBYTES],
+                         const uint8_t rho[KYBER_SYMBYTES],
+                         const uint8_t pw[KYBER_SYMBYTES],
+                         const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t mask_seed_t[KYBER_SYMBYTES];
+  polyvec mask_t;
+
+  hic_mask_seed(mask_seed_t,rho,pw,sid);
+
+  // H'(mask_seed_t) -> mask_t
+  pake_gen_vector(&mask_t,mask_seed_t); 
+
+  // unmask vec part of icc into pk and pkpv
+  polyvec_mask_sub(pk, pkpv, icc, &mask_t);
+  memcpy(pk+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,rho,KYBER_SYMBYTES);
+}
 
 /*************************************************
 * Name:        hic_eval
@@ -51,50 +251,15 @@ void hic_eval(uint8_t icc[KYBER_PUBLICKEYBYTES],
               const uint8_t pw[KYBER_SYMBYTES],
               const uint8_t sid[KYBER_SYMBYTES])
 {
-  uint8_t hash_in_lr[3*KYBER_SYMBYTES];
-  uint8_t hash_in_rl[2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES];
   uint8_t in_rho[KYBER_SYMBYTES];
   uint8_t key[KYBER_SYMBYTES];
-  uint8_t mask_seed_t[KYBER_SYMBYTES];
-  polyvec in_t, mask_t;
-
-  //unpack seed part of pk
-  memcpy(in_rho,pk+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,KYBER_SYMBYTES);
 
-  // H(pw || rho) -> mask_seed_t
-  uint8_t *hin_lr_pw = hash_in_lr;
-  uint8_t *hin_lr_sid = hash_in_lr+KYBER_SYMBYTES;
-  uint8_t *hin_lr_seed = hash_in_lr+2*KYBER_SYMBYTES;
-  memcpy(hin_lr_pw,pw,KYBER_SYMBYTES);
-  memcpy(hin_lr_sid,sid,KYBER_SYMBYTES);
-  memcpy(hin_lr_seed,in_rho,KYBER_SYMBYTES);
-  hash_h(mask_seed_t,hash_in_lr,3*KYBER_SYMBYTES);
-
-  //unpack vec part of pk
-  polyvec_frombytes(&in_t, pk);
-
-  // H'(mask_seed_t) -> mask_t
-  gen_vector(&mask_t,mask_seed_t); 
-  polyvec_add(&mask_t,&mask_t,&in_t);
-  polyvec_reduce(&mask_t);
-
-  //pack vec part of masked pk for hashing
-  polyvec_tobytes(icc, &mask_t);
-
-  // G(pw,vecpartpk) -> key
-  uint8_t *hin_rl_pw = hash_in_rl;
-  uint8_t *hin_rl_sid = hash_in_rl+KYBER_SYMBYTES;
-  uint8_t *hin_rl_pk = hash_in_rl+2*KYBER_SYMBYTES;
-  memcpy(hin_rl_pw,pw,KYBER_SYMBYTES);
-  memcpy(hin_rl_sid,sid,KYBER_SYMBYTES);
-  memcpy(hin_rl_pk,icc,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
-  hash_h(key,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+  hic_eval_pre(icc,key,in_rho,pk,pw,sid);
 
   ic256_enc(in_rho,key);
 
   // pack second part of pk
   memcpy(icc+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,in_rho,KYBER_SYMBYTES);
-
 }
 
 /*************************************************
@@ -116,49 +281,141 @@ void hic_inv(uint8_t pk[KYBER_PUBLICKEYBYTES],
               const uint8_t pw[KYBER_SYMBYTES],
               const uint8_t sid[KYBER_SYMBYTES])
 {
-  uint8_t hash_in_lr[3*KYBER_SYMBYTES];
-  uint8_t hash_in_rl[2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES];
+  polyvec pkpv;
+
+  hic_inv_unpacked(pk,&pkpv,icc,pw,sid);
+}
+
+/*************************************************
+* Name:        hic_inv_unpacked
+*
+* Description: hic_inv, also returning the vector part of pk as the
+*              polyvec it was packed from
+*
+* Arguments:   - uint8_t *pk: pointer to output public key
+*                             (of length KYBER_PUBLICKEYBYTES bytes)
+*              - polyvec *pkpv: pointer to output vector part of pk
+*              - uint8_t *icc: pointer to inputciphertext
+*                             (of length KYBER_PUBLICKEYBYTES bytes)
+*              - uint8_t *pw: pointer to input password
+*                             (of length KYBER_SYMBYTES bytes)
+*              - uint8_t *sid: pointer to input sid
+*                             (of length KYBER_SYMBYTES bytes)
+**************************************************/
+void hic_inv_unpacked(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                      polyvec *pkpv,
+                      const uint8_t icc[KYBER_PUBLICKEYBYTES],
+                      const uint8_t pw[KYBER_SYMBYTES],
+                      const uint8_t sid[KYBER_SYMBYTES])
+{
   uint8_t in_rho[KYBER_SYMBYTES];
   uint8_t key[KYBER_SYMBYTES];
-  uint8_t mask_seed_t[KYBER_SYMBYTES];
-  polyvec in_t, mask_t;
-
-  // G(pw,vecpartpk) -> key
-  uint8_t *hin_rl_pw = hash_in_rl;
-  uint8_t *hin_rl_sid = hash_in_rl+KYBER_SYMBYTES;
-  uint8_t *hin_rl_pk = hash_in_rl+2*KYBER_SYMBYTES;
 
-  memcpy(hin_rl_pw,pw,KYBER_SYMBYTES);
-  memcpy(hin_rl_sid,sid,KYBER_SYMBYTES);
-  memcpy(hin_rl_pk,icc,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
-  hash_h(key,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+  hic_key(key,icc,pw,sid);
 
   // unpack and decrypt seed part of icc
   memcpy(in_rho,icc+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,KYBER_SYMBYTES);
   ic256_dec(in_rho,key);
 
-  // H(pw || rho) -> mask_seed_t
-  uint8_t *hin_lr_pw = hash_in_lr;
-  uint8_t *hin_lr_sid = hash_in_lr+KYBER_SYMBYTES;
-  uint8_t *hin_lr_seed = hash_in_lr+2*KYBER_SYMBYTES;
-  memcpy(hin_lr_pw,pw,KYBER_SYMBYTES);
-  memcpy(hin_lr_sid,sid,KYBER_SYMBYTES);
-  memcpy(hin_lr_seed,in_rho,KYBER_SYMBYTES);
+  hic_inv_post(pk,pkpv,icc,in_rho,pw,sid);
+}
 
-  hash_h(mask_seed_t,hash_in_lr,3*KYBER_SYMBYTES);
+/*************************************************
+* Name:        hic_eval_xN
+*
+* Description: Computes hic_eval for n independent inputs, running
+*              the ideal cipher on all seeds together (bitsliced and
+*              constant-time when the CPU has AVX2)
+*
+* Arguments:   - uint8_t (*icc): n output ciphertexts
+*              - uint8_t (*pk): n input public keys
+*              - uint8_t (*pw): n input passwords
+*              - uint8_t (*sid): n input sids
+*              - size_t n: number of inputs
+**************************************************/
+void hic_eval_xN(uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                 const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                 const uint8_t (*pw)[KYBER_SYMBYTES],
+                 const uint8_t (*sid)[KYBER_SYMBYTES],
+                 size_t n)
+{
+  uint8_t in_rho[HIC_BATCH][KYBER_SYMBYTES];
+  uint8_t key[HIC_BATCH][KYBER_SYMBYTES];
+  size_t i, j, m;
 
-  //unpack vec part of pk
-  polyvec_frombytes(&in_t, icc);
+  for(i=0;i<n;i+=m) {
+    m = n-i < HIC_BATCH ? n-i : HIC_BATCH;
+    for(j=0;j<m;j++)
+      hic_eval_pre(icc[i+j],key[j],in_rho[j],pk[i+j],pw[i+j],sid[i+j]);
 
+    ic256_enc_xN(in_rho,(const uint8_t (*)[KYBER_SYMBYTES])key,m);
 
-  // H'(mask_seed_t) -> mask_t
-  gen_vector(&mask_t,mask_seed_t); 
-  polyvec_sub(&mask_t,&in_t,&mask_t);
-  polyvec_reduce(&mask_t);
+    for(j=0;j<m;j++)
+      memcpy(icc[i+j]+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,in_rho[j],KYBER_SYMBYTES);
+  }
+}
+
+/*************************************************
+* Name:        hic_inv_xN
+*
+* Description: Computes hic_inv for n independent inputs, see
+*              hic_eval_xN
+*
+* Arguments:   - uint8_t (*pk): n output public keys
+*              - uint8_t (*icc): n input ciphertexts
+*              - uint8_t (*pw): n input passwords
+*              - uint8_t (*sid): n input sids
+*              - size_t n: number of inputs
+**************************************************/
+void hic_inv_xN(uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                const uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                const uint8_t (*pw)[KYBER_SYMBYTES],
+                const uint8_t (*sid)[KYBER_SYMBYTES],
+                size_t n)
+{
+  polyvec pkpv[HIC_BATCH];
+  size_t i, m;
+
+  for(i=0;i<n;i+=m) {
+    m = n-i < HIC_BATCH ? n-i : HIC_BATCH;
+    hic_inv_unpacked_xN(pk+i,pkpv,icc+i,pw+i,sid+i,m);
+  }
+}
+
+/*************************************************
+* Name:        hic_inv_unpacked_xN
+*
+* Description: hic_inv_unpacked for n independent inputs: the key
+*              hashes over the masked vectors run four at a time,
+*              the ideal cipher as in hic_eval_xN
+*
+* Arguments:   - uint8_t (*pk): n output public keys
+*              - polyvec *pkpv: n output vector parts of pk
+*              - uint8_t (*icc): n input ciphertexts
+*              - uint8_t (*pw): n input passwords
+*              - uint8_t (*sid): n input sids
+*              - size_t n: number of inputs
+**************************************************/
+void hic_inv_unpacked_xN(uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                         polyvec *pkpv,
+                         const uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                         const uint8_t (*pw)[KYBER_SYMBYTES],
+                         const uint8_t (*sid)[KYBER_SYMBYTES],
+                         size_t n)
+{
+  uint8_t in_rho[HIC_BATCH][KYBER_SYMBYTES];
+  uint8_t key[HIC_BATCH][KYBER_SYMBYTES];
+  size_t i, j, m;
 
-  //pack_pk
-  polyvec_tobytes(pk, &mask_t);
-  memcpy(pk+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,in_rho,KYBER_SYMBYTES);
+  for(i=0;i<n;i+=m) {
+    m = n-i < HIC_BATCH ? n-i : HIC_BATCH;
+    hic_key_xN(key,icc+i,pw+i,sid+i,m);
+    for(j=0;j<m;j++)
+      memcpy(in_rho[j],icc[i+j]+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES,KYBER_SYMBYTES);
 
+    ic256_dec_xN(in_rho,(const uint8_t (*)[KYBER_SYMBYTES])key,m);
 
+    for(j=0;j<m;j++)
+      hic_inv_post(pk[i+j],&pkpv[i+j],icc[i+j],in_rho[j],pw[i+j],sid[i+j]);
+  }
 }
@@ -1,6 +1,7 @@
 #ifndef HIC_H
 #define HIC_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "params.h"
 #include "polyvec.h"
@@ -22,4 +23,40 @@ void hic_inv(uint8_t pk[KYBER_PUBLICKEYBYTES],
              const uint8_t pw[KYBER_SYMBYTES],
              const uint8_t sid[KYBER_SYMBYTES]);
 
+// hic_inv that also hands out the unmasked vector part of pk
+// unpacked, for kem_enc_unpacked
+void hic_inv_unpacked(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                      polyvec *pkpv,
+                      const uint8_t icc[KYBER_PUBLICKEYBYTES],
+                      const uint8_t pw[KYBER_SYMBYTES],
+                      const uint8_t sid[KYBER_SYMBYTES]);
+
+/*
+  Batched versions: n independent evaluations, with the ideal
+  cipher run on HIC_BATCH seeds at a time by the bitsliced,
+  constant-time Rijndael-256 when the CPU supports AVX2, and the
+  key hashes of hic_inv four at a time on the x4 Keccak (genx4.h).
+*/
+
+#define HIC_BATCH 8
+
+void hic_eval_xN(uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                 const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                 const uint8_t (*pw)[KYBER_SYMBYTES],
+                 const uint8_t (*sid)[KYBER_SYMBYTES],
+                 size_t n);
+
+void hic_inv_xN(uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                const uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                const uint8_t (*pw)[KYBER_SYMBYTES],
+                const uint8_t (*sid)[KYBER_SYMBYTES],
+                size_t n);
+
+void hic_inv_unpacked_xN(uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                         polyvec *pkpv,
+                         const uint8_t (*icc)[KYBER_PUBLICKEYBYTES],
+                         const uint8_t (*pw)[KYBER_SYMBYTES],
+                         const uint8_t (*sid)[KYBER_SYMBYTES],
+                         size_t n);
+
 #endif
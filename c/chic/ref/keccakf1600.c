@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <stdatomic.h>
+#include "keccakf1600.h"
+
+#define ROL(a, offset) (((a) << (offset)) ^ ((a) >> (64-(offset))))
+
+/*
+  One round reads the state from the lanes prefixed A and writes
+  it to the lanes prefixed E; the unrolled permutation alternates
+  A->E and E->A, so no copies are needed between rounds.
+*/
+
+#define LANES(X) \
+  uint64_t X##ba, X##be, X##bi, X##bo, X##bu, \
+           X##ga, X##ge, X##gi, X##go, X##gu, \
+           X##ka, X##ke, X##ki, X##ko, X##ku, \
+           X##ma, X##me, X##mi, X##mo, X##mu, \
+           X##sa, X##se, X##si, X##so, X##su
+
+#define THETA(A) \
+  Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+  Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+  Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+  Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+  Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+  Da = Cu ^ ROL(Ce, 1); \
+  De = Ca ^ ROL(Ci, 1); \
+  Di = Ce ^ ROL(Co, 1); \
+  Do = Ci ^ ROL(Cu, 1); \
+  Du = Co ^ ROL(Ca, 1);
+
+/*
+  rho and pi, one output plane at a time right before its chi, so
+  that only five B lanes are live at once.
+*/
+
+#define PLANE_B(A) \
+  Ba = A##ba ^ Da; \
+  Be = ROL(A##ge ^ De, 44); \
+  Bi = ROL(A##ki ^ Di, 43); \
+  Bo = ROL(A##mo ^ Do, 21); \
+  Bu = ROL(A##su ^ Du, 14);
+
+#define PLANE_G(A) \
+  Ba = ROL(A##bo ^ Do, 28); \
+  Be = ROL(A##gu ^ Du, 20); \
+  Bi = ROL(A##ka ^ Da, 3); \
+  Bo = ROL(A##me ^ De, 45); \
+  Bu = ROL(A##si ^ Di, 61);
+
+#define PLANE_K(A) \
+  Ba = ROL(A##be ^ De, 1); \
+  Be = ROL(A##gi ^ Di, 6); \
+  Bi = ROL(A##ko ^ Do, 25); \
+  Bo = ROL(A##mu ^ Du, 8); \
+  Bu = ROL(A##sa ^ Da, 18);
+
+#define PLANE_M(A) \
+  Ba = ROL(A##bu ^ Du, 27); \
+  Be = ROL(A##ga ^ Da, 36); \
+  Bi = ROL(A##ke ^ De, 10); \
+  Bo = ROL(A##mi ^ Di, 15); \
+  Bu = ROL(A##so ^ Do, 56);
+
+#define PLANE_S(A) \
+  Ba = ROL(A##bi ^ Di, 62); \
+  Be = ROL(A##go ^ Do, 55); \
+  Bi = ROL(A##ku ^ Du, 39); \
+  Bo = ROL(A##ma ^ Da, 41); \
+  Bu = ROL(A##se ^ De, 2);
+
+#define CHI_PLAIN(E, P) \
+  E##P##a = Ba ^ (~Be & Bi); \
+  E##P##e = Be ^ (~Bi & Bo); \
+  E##P##i = Bi ^ (~Bo & Bu); \
+  E##P##o = Bo ^ (~Bu & Ba); \
+  E##P##u = Bu ^ (~Ba & Be);
+
+#define ROUND_PLAIN(A, E, RC) \
+  THETA(A) \
+  PLANE_B(A) CHI_PLAIN(E, b) E##ba ^= (RC); \
+  PLANE_G(A) CHI_PLAIN(E, g) \
+  PLANE_K(A) CHI_PLAIN(E, k) \
+  PLANE_M(A) CHI_PLAIN(E, m) \
+  PLANE_S(A) CHI_PLAIN(E, s)
+
+// be, bi, go, ki, mi and sa stay complemented across rounds
+#define ROUND_COMPL(A, E, RC) \
+  THETA(A) \
+  PLANE_B(A) \
+  E##ba = Ba ^ (Be | Bi) ^ (RC); \
+  E##be = Be ^ (~Bi | Bo); \
+  E##bi = Bi ^ (Bo & Bu); \
+  E##bo = Bo ^ (Bu | Ba); \
+  E##bu = Bu ^ (Ba & Be); \
+  PLANE_G(A) \
+  E##ga = Ba ^ (Be | Bi); \
+  E##ge = Be ^ (Bi & Bo); \
+  E##gi = Bi ^ (Bo | ~Bu); \
+  E##go = Bo ^ (Bu | Ba); \
+  E##gu = Bu ^ (Ba & Be); \
+  PLANE_K(A) \
+  E##ka = Ba ^ (Be | Bi); \
+  E##ke = Be ^ (Bi & Bo); \
+  E##ki = Bi ^ (~Bo & Bu); \
+  E##ko = ~Bo ^ (Bu | Ba); \
+  E##ku = Bu ^ (Ba & Be); \
+  PLANE_M(A) \
+  E##ma = Ba ^ (Be & Bi); \
+  E##me = Be ^ (Bi | Bo); \
+  E##mi = Bi ^ (~Bo | Bu); \
+  E##mo = ~Bo ^ (Bu & Ba); \
+  E##mu = Bu ^ (Ba | Be); \
+  PLANE_S(A) \
+  E##sa = Ba ^ (~Be & Bi); \
+  E##se = ~Be ^ (Bi | Bo); \
+  E##si = Bi ^ (Bo & Bu); \
+  E##so = Bo ^ (Bu | Ba); \
+  E##su = Bu ^ (Ba & Be);
+
+// Keccak-p[1600,12] (TurboSHAKE) is the second half: rounds 12 to 23
+#define ROUNDS_0_11(R) \
+  R(A, E, 0x0000000000000001ULL) R(E, A, 0x0000000000008082ULL) \
+  R(A, E, 0x800000000000808aULL) R(E, A, 0x8000000080008000ULL) \
+  R(A, E, 0x000000000000808bULL) R(E, A, 0x0000000080000001ULL) \
+  R(A, E, 0x8000000080008081ULL) R(E, A, 0x8000000000008009ULL) \
+  R(A, E, 0x000000000000008aULL) R(E, A, 0x0000000000000088ULL) \
+  R(A, E, 0x0000000080008009ULL) R(E, A, 0x000000008000000aULL)
+
+#define ROUNDS_12_23(R) \
+  R(A, E, 0x000000008000808bULL) R(E, A, 0x800000000000008bULL) \
+  R(A, E, 0x8000000000008089ULL) R(E, A, 0x8000000000008003ULL) \
+  R(A, E, 0x8000000000008002ULL) R(E, A, 0x8000000000000080ULL) \
+  R(A, E, 0x000000000000800aULL) R(E, A, 0x800000008000000aULL) \
+  R(A, E, 0x8000000080008081ULL) R(E, A, 0x8000000000008080ULL) \
+  R(A, E, 0x0000000080000001ULL) R(E, A, 0x8000000080008008ULL)
+
+#define LOAD(s) \
+  Aba = s[0];  Abe = s[1];  Abi = s[2];  Abo = s[3];  Abu = s[4]; \
+  Aga = s[5];  Age = s[6];  Agi = s[7];  Ago = s[8];  Agu = s[9]; \
+  Aka = s[10]; Ake = s[11]; Aki = s[12]; Ako = s[13]; Aku = s[14]; \
+  Ama = s[15]; Ame = s[16]; Ami = s[17]; Amo = s[18]; Amu = s[19]; \
+  Asa = s[20]; Ase = s[21]; Asi = s[22]; Aso = s[23]; Asu = s[24];
+
+#define STORE(s) \
+  s[0] = Aba;  s[1] = Abe;  s[2] = Abi;  s[3] = Abo;  s[4] = Abu; \
+  s[5] = Aga;  s[6] = Age;  s[7] = Agi;  s[8] = Ago;  s[9] = Agu; \
+  s[10] = Aka; s[11] = Ake; s[12] = Aki; s[13] = Ako; s[14] = Aku; \
+  s[15] = Ama; s[16] = Ame; s[17] = Ami; s[18] = Amo; s[19] = Amu; \
+  s[20] = Asa; s[21] = Ase; s[22] = Asi; s[23] = Aso; s[24] = Asu;
+
+#define COMPLEMENT \
+  Abe = ~Abe; Abi = ~Abi; Ago = ~Ago; Aki = ~Aki; Ami = ~Ami; Asa = ~Asa;
+
+#define PERMUTE_COMPL(s, ROUNDS) \
+  LANES(A); \
+  LANES(E); \
+  uint64_t Ba, Be, Bi, Bo, Bu; \
+  uint64_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du; \
+  LOAD(s) \
+  COMPLEMENT \
+  ROUNDS(ROUND_COMPL) \
+  COMPLEMENT \
+  STORE(s)
+
+#define PERMUTE_PLAIN(s, ROUNDS) \
+  LANES(A); \
+  LANES(E); \
+  uint64_t Ba, Be, Bi, Bo, Bu; \
+  uint64_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du; \
+  LOAD(s) \
+  ROUNDS(ROUND_PLAIN) \
+  STORE(s)
+
+#define ROUNDS24(R) ROUNDS_0_11(R) ROUNDS_12_23(R)
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute_compl
+*
+* Description: Keccak-f[1600], fully unrolled, with lane complementing
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+void KeccakF1600_StatePermute_compl(uint64_t s[25])
+{
+  PERMUTE_COMPL(s, ROUNDS24)
+}
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute_bmi
+*
+* Description: Keccak-f[1600], fully unrolled, plain chi for ANDN
+*              and the rotations as RORX
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+__attribute__((target("bmi,bmi2")))
+static void KeccakF1600_StatePermute_bmi(uint64_t s[25])
+{
+  PERMUTE_PLAIN(s, ROUNDS24)
+}
+
+/*************************************************
+* Name:        KeccakP1600_12_StatePermute_compl
+*
+* Description: Keccak-p[1600,12], the last 12 rounds of Keccak-f[1600],
+*              with lane complementing
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+void KeccakP1600_12_StatePermute_compl(uint64_t s[25])
+{
+  PERMUTE_COMPL(s, ROUNDS_12_23)
+}
+
+/*************************************************
+* Name:        KeccakP1600_12_StatePermute_bmi
+*
+* Description: Keccak-p[1600,12], plain chi for ANDN and RORX
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+__attribute__((target("bmi,bmi2")))
+static void KeccakP1600_12_StatePermute_bmi(uint64_t s[25])
+{
+  PERMUTE_PLAIN(s, ROUNDS_12_23)
+}
+static atomic_int keccakf1600_cpu = -1;
+
+int keccakf1600_bmi_available(void)
+{
+  int cpu = atomic_load_explicit(&keccakf1600_cpu, memory_order_relaxed);
+
+  if(cpu < 0) {
+    __builtin_cpu_init();
+    cpu = __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+    atomic_store_explicit(&keccakf1600_cpu, cpu, memory_order_relaxed);
+  }
+  return cpu;
+}
+
+/*************************************************
+* Name:        KeccakF1600_StatePermute_fast
+*
+* Description: Keccak-f[1600]; the BMI version where the CPU has it,
+*              the complemented one otherwise
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+void KeccakF1600_StatePermute_fast(uint64_t s[25])
+{
+  if(keccakf1600_bmi_available())
+    KeccakF1600_StatePermute_bmi(s);
+  else
+    KeccakF1600_StatePermute_compl(s);
+}
+
+/*************************************************
+* Name:        KeccakP1600_12_StatePermute_fast
+*
+* Description: Keccak-p[1600,12]; the BMI version where the CPU has
+*              it, the complemented one otherwise
+*
+* Arguments:   - uint64_t *s: pointer to input/output Keccak state
+**************************************************/
+void KeccakP1600_12_StatePermute_fast(uint64_t s[25])
+{
+  if(keccakf1600_bmi_available())
+    KeccakP1600_12_StatePermute_bmi(s);
+  else
+    KeccakP1600_12_StatePermute_compl(s);
+}
@@ -0,0 +1,63 @@
+#ifndef KEMFAT_H
+#define KEMFAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+#include "polyvec.h"
+
+/*
+  ML-KEM entry points working on unpacked keys, layered over the
+  Kyber ref code (gen_matrix and the poly/polyvec arithmetic).
+  Outputs match crypto_kem_keypair_derand, crypto_kem_enc_derand and
+  crypto_kem_dec bit for bit.
+
+  crypto_kem_dec re-encrypts (FO transform) and so expands matrix A
+  from rho again and unpacks pk and sk; kem_fat_keypair keeps A^T,
+  t and s in the NTT domain as keygen produced them, so
+  kem_fat_dec does neither.
+
+  kem_enc_unpacked takes t as the polyvec the caller already holds
+  (the responder just unmasked it) next to the packed pk, which is
+  still needed for H(pk), so t is not parsed back from pk.
+  kem_enc_unpacked_xN does n of them with H(pk) computed four at a
+  time (genx4.h), for resp_batch.
+*/
+
+typedef struct {
+  polyvec at[KYBER_K];             // A^T, NTT domain
+  polyvec pkpv;                    // t, NTT domain
+  polyvec skpv;                    // s, NTT domain
+  uint8_t hpk[KYBER_SYMBYTES];     // H(pk)
+  uint8_t z[KYBER_SYMBYTES];       // implicit rejection key
+} kem_fat_sk;
+
+void kem_fat_keypair_derand(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                            kem_fat_sk *sk,
+                            const uint8_t coins[2*KYBER_SYMBYTES]);
+
+void kem_fat_keypair(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                     kem_fat_sk *sk);
+
+void kem_enc_unpacked_derand(uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                             uint8_t ss[KYBER_SSBYTES],
+                             const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                             const polyvec *pkpv,
+                             const uint8_t coins[KYBER_SYMBYTES]);
+
+void kem_enc_unpacked(uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                      uint8_t ss[KYBER_SSBYTES],
+                      const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                      const polyvec *pkpv);
+
+void kem_enc_unpacked_xN(uint8_t (*ct)[KYBER_CIPHERTEXTBYTES],
+                         uint8_t (*ss)[KYBER_SSBYTES],
+                         const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                         const polyvec *pkpv,
+                         size_t n);
+
+void kem_fat_dec(uint8_t ss[KYBER_SSBYTES],
+                 const uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                 const kem_fat_sk *sk);
+
+#endif
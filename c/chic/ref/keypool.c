@@ -0,0 +1,171 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "params.h"
+#include "kem.h"
+#include "keypool.h"
+
+// pause of the generator thread when the ring is full
+#define KEYPOOL_IDLE_NS 50000
+
+// memset through a volatile pointer: a wipe right before free() is a
+// dead store the compiler may otherwise drop
+static void *(*const volatile keypool_memset)(void *, int, size_t) = memset;
+
+typedef struct {
+  atomic_size_t seq;
+  uint8_t pk[KYBER_PUBLICKEYBYTES];
+  uint8_t sk[KYBER_SECRETKEYBYTES];
+} keypool_slot;
+
+struct keypool {
+  keypool_slot *slots;
+  size_t mask;
+  atomic_size_t head;
+  atomic_size_t tail;
+  atomic_int running;
+  atomic_uint_fast64_t hits;
+  atomic_uint_fast64_t misses;
+  pthread_t thread;
+};
+
+/*************************************************
+* Name:        keypool_push
+*
+* Description: Generates one keypair into the next free slot
+*
+* Returns 0 if a keypair was added, -1 if the ring is full
+**************************************************/
+static int keypool_push(keypool *pool)
+{
+  size_t pos = atomic_load_explicit(&pool->tail, memory_order_relaxed);
+  keypool_slot *slot = &pool->slots[pos & pool->mask];
+  size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+  // slot still holds a keypair nobody has popped yet
+  if(seq != pos)
+    return -1;
+
+  // single producer: the slot is ours until seq is published
+  atomic_store_explicit(&pool->tail, pos+1, memory_order_relaxed);
+  crypto_kem_keypair(slot->pk, slot->sk);
+  atomic_store_explicit(&slot->seq, pos+1, memory_order_release);
+  return 0;
+}
+
+static void *keypool_run(void *arg)
+{
+  keypool *pool = arg;
+  struct timespec idle = { 0, KEYPOOL_IDLE_NS };
+
+  while(atomic_load_explicit(&pool->running, memory_order_relaxed)) {
+    if(keypool_push(pool))
+      nanosleep(&idle, NULL);
+  }
+  return NULL;
+}
+
+keypool *keypool_new(size_t capacity)
+{
+  keypool *pool;
+  size_t n = 1, i;
+
+  while(n < capacity)
+    n <<= 1;
+
+  pool = malloc(sizeof(keypool));
+  if(pool == NULL)
+    return NULL;
+  pool->slots = malloc(n*sizeof(keypool_slot));
+  if(pool->slots == NULL) {
+    free(pool);
+    return NULL;
+  }
+  for(i=0;i<n;i++)
+    atomic_init(&pool->slots[i].seq, i);
+  pool->mask = n-1;
+  atomic_init(&pool->head, 0);
+  atomic_init(&pool->tail, 0);
+  atomic_init(&pool->running, 1);
+  atomic_init(&pool->hits, 0);
+  atomic_init(&pool->misses, 0);
+
+  if(pthread_create(&pool->thread, NULL, keypool_run, pool)) {
+    free(pool->slots);
+    free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void keypool_free(keypool *pool)
+{
+  if(pool == NULL)
+    return;
+  atomic_store(&pool->running, 0);
+  pthread_join(pool->thread, NULL);
+  // keypairs never handed out are secret material
+  keypool_memset(pool->slots, 0, (pool->mask+1)*sizeof(keypool_slot));
+  free(pool->slots);
+  free(pool);
+}
+
+int keypool_pop(keypool *pool,
+                uint8_t pk[KYBER_PUBLICKEYBYTES],
+                uint8_t sk[KYBER_SECRETKEYBYTES])
+{
+  size_t pos = atomic_load_explicit(&pool->head, memory_order_relaxed);
+  keypool_slot *slot;
+  size_t seq;
+
+  for(;;) {
+    slot = &pool->slots[pos & pool->mask];
+    seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if(seq == pos+1) {
+      // filled: claim it, or retry from wherever head moved to
+      if(atomic_compare_exchange_weak_explicit(&pool->head, &pos, pos+1,
+                                               memory_order_relaxed,
+                                               memory_order_relaxed))
+        break;
+    }
+    else if(seq == pos) {
+      // not filled yet: empty
+      atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+      return -1;
+    }
+    else
+      pos = atomic_load_explicit(&pool->head, memory_order_relaxed);
+  }
+
+  memcpy(pk, slot->pk, KYBER_PUBLICKEYBYTES);
+  memcpy(sk, slot->sk, KYBER_SECRETKEYBYTES);
+  memset(slot->sk, 0, KYBER_SECRETKEYBYTES);
+  atomic_store_explicit(&slot->seq, pos+pool->mask+1, memory_order_release);
+  atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+  return 0;
+}
+
+size_t keypool_available(keypool *pool)
+{
+  size_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&pool->tail, memory_order_acquire);
+  keypool_slot *last;
+
+  if(tail <= head)
+    return 0;
+  // the newest slot may still be under construction
+  last = &pool->slots[(tail-1) & pool->mask];
+  if(atomic_load_explicit(&last->seq, memory_order_acquire) != tail)
+    return tail - head - 1;
+  return tail - head;
+}
+
+void keypool_stats(keypool *pool, uint64_t *hits, uint64_t *misses)
+{
+  *hits = atomic_load_explicit(&pool->hits, memory_order_relaxed);
+  *misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+}
@@ -2,14 +2,138 @@
 #include <stdint.h>
 #include <string.h>
 #include "params.h"
+#include "genx4.h"
 #include "hic.h"
 #include "kem.h"
+#include "kemfat.h"
 #include "pake.h"
+#include "randombytes.h"
 #include "symmetric.h"
+#include "sha3inc.h"
 #include "verify.h"
 
 #include<stdio.h>
 
+#ifdef PAKE_TRANSCRIPT_PREFIX
+/*************************************************
+* Name:        transcript_prefix
+*
+* Description: Absorbs the part of the transcript that is known when
+*              msg1 is sent, sid,pk,apk, into a fresh state
+**************************************************/
+static void transcript_prefix(keccak_state *state,
+                              const uint8_t sid[KYBER_SYMBYTES],
+                              const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                              const uint8_t apk[KYBER_PUBLICKEYBYTES])
+{
+  hash_g_init(state);
+  hash_g_absorb(state,sid,KYBER_SYMBYTES);
+  hash_g_absorb(state,pk,KYBER_PUBLICKEYBYTES);
+  hash_g_absorb(state,apk,KYBER_PUBLICKEYBYTES);
+}
+
+/*************************************************
+* Name:        transcript_finish
+*
+* Description: keytag = G(sid,pk,apk,cph,K_s) from a prefix state
+**************************************************/
+static void transcript_finish(uint8_t keytag[2*KYBER_SYMBYTES],
+                              keccak_state *state,
+                              const uint8_t cph[KYBER_CIPHERTEXTBYTES],
+                              const uint8_t ss[KYBER_SYMBYTES])
+{
+  hash_g_absorb(state,cph,KYBER_CIPHERTEXTBYTES);
+  hash_g_absorb(state,ss,KYBER_SYMBYTES);
+  hash_g_final(keytag,state);
+}
+#endif
+
+/*************************************************
+* Name:        transcript_hash
+*
+* Description: keytag = G(K_s,sid,pk,apk,cph), absorbing every part
+*              from where it already lives. With PAKE_TRANSCRIPT_PREFIX
+*              the order is G(sid,pk,apk,cph,K_s) instead
+**************************************************/
+static void transcript_hash(uint8_t keytag[2*KYBER_SYMBYTES],
+                            const uint8_t ss[KYBER_SYMBYTES],
+                            const uint8_t sid[KYBER_SYMBYTES],
+                            const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                            const uint8_t apk[KYBER_PUBLICKEYBYTES],
+                            const uint8_t cph[KYBER_CIPHERTEXTBYTES])
+{
+  keccak_state state;
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  transcript_prefix(&state,sid,pk,apk);
+  transcript_finish(keytag,&state,cph,ss);
+#else
+  hash_g_init(&state);
+  hash_g_absorb(&state,ss,KYBER_SYMBYTES);
+  hash_g_absorb(&state,sid,KYBER_SYMBYTES);
+  hash_g_absorb(&state,pk,KYBER_PUBLICKEYBYTES);
+  hash_g_absorb(&state,apk,KYBER_PUBLICKEYBYTES);
+  hash_g_absorb(&state,cph,KYBER_CIPHERTEXTBYTES);
+  hash_g_final(keytag,&state);
+#endif
+}
+
+/*************************************************
+* Name:        transcript_hash_xN
+*
+* Description: transcript_hash for m <= PAKE_BATCH sessions, four at
+*              a time on the four-lane Keccak (a group of one on the
+*              single-state one); cph is read from msg2
+**************************************************/
+static void transcript_hash_xN(uint8_t (*keytag)[2*KYBER_SYMBYTES],
+                               const uint8_t (*ss)[KYBER_SYMBYTES],
+                               const uint8_t (*sid)[KYBER_SYMBYTES],
+                               const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                               const uint8_t (*msg1)[MSG1_LEN],
+                               const uint8_t (*msg2)[MSG2_LEN],
+                               size_t m)
+{
+  uint8_t scratch[2*KYBER_SYMBYTES];
+  const uint8_t *in_ss[4], *in_sid[4], *in_pk[4], *in_apk[4], *in_cph[4];
+  uint8_t *out[4];
+  keccakx4_state state;
+  size_t i, j;
+  unsigned int l, k;
+
+  for(i=0;i<m;i+=k) {
+    k = m-i < 4 ? m-i : 4;
+    if(k == 1) {
+      transcript_hash(keytag[i],ss[i],sid[i],pk[i],msg1[i],msg2[i]+KYBER_SYMBYTES);
+      continue;
+    }
+    // unused lanes hash the first session of the group again
+    for(l=0;l<4;l++) {
+      j = i + (l < k ? l : 0);
+      in_ss[l] = ss[j];
+      in_sid[l] = sid[j];
+      in_pk[l] = pk[j];
+      in_apk[l] = msg1[j];
+      in_cph[l] = msg2[j]+KYBER_SYMBYTES;
+      out[l] = l < k ? keytag[i+l] : scratch;
+    }
+    hash_gx4_init(&state);
+#ifdef PAKE_TRANSCRIPT_PREFIX
+    hash_gx4_absorb(&state,in_sid,KYBER_SYMBYTES);
+    hash_gx4_absorb(&state,in_pk,KYBER_PUBLICKEYBYTES);
+    hash_gx4_absorb(&state,in_apk,KYBER_PUBLICKEYBYTES);
+    hash_gx4_absorb(&state,in_cph,KYBER_CIPHERTEXTBYTES);
+    hash_gx4_absorb(&state,in_ss,KYBER_SYMBYTES);
+#else
+    hash_gx4_absorb(&state,in_ss,KYBER_SYMBYTES);
+    hash_gx4_absorb(&state,in_sid,KYBER_SYMBYTES);
+    hash_gx4_absorb(&state,in_pk,KYBER_PUBLICKEYBYTES);
+    hash_gx4_absorb(&state,in_apk,KYBER_PUBLICKEYBYTES);
+    hash_gx4_absorb(&state,in_cph,KYBER_CIPHERTEXTBYTES);
+#endif
+    hash_gx4_final(out,&state);
+  }
+}
+
 /*************************************************
 * Name:        initStart
 *
@@ -38,6 +162,33 @@ void initStart(uint8_t msg1[MSG1_LEN],
   hic_eval(msg1,pk,pw,sid);  
 }
 
+#ifdef PAKE_KEYPOOL
+/*************************************************
+* Name:        initStartPool
+*
+* Description: initStart taking the keypair from a keypool filled
+*              in the background; generates it inline when the pool
+*              is empty (or NULL)
+*
+* Results:     as initStart
+* 
+* Arguments:   as initStart, plus
+*              keypool *pool: the keypair pool
+* 
+**************************************************/
+void initStartPool(uint8_t msg1[MSG1_LEN], 
+                   uint8_t pk[KYBER_PUBLICKEYBYTES],   
+                   uint8_t sk[KYBER_SECRETKEYBYTES],   
+                   const uint8_t pw[KYBER_SYMBYTES],   
+                   const uint8_t sid[KYBER_SYMBYTES],
+                   keypool *pool)
+{
+  if(pool == NULL || keypool_pop(pool,pk,sk))
+    crypto_kem_keypair(pk,sk);
+  hic_eval(msg1,pk,pw,sid);  
+}
+#endif
+
 /*************************************************
 * Name:        initEnd
 *
@@ -68,16 +219,12 @@ int initEnd(uint8_t key[KYBER_SYMBYTES],
 {
   int result;
   uint8_t keytag[2*KYBER_SYMBYTES];
-  uint8_t hashin[2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES];
+  uint8_t ss[KYBER_SYMBYTES];
 
-  crypto_kem_dec(hashin,msg2+KYBER_SYMBYTES,sk);
+  crypto_kem_dec(ss,msg2+KYBER_SYMBYTES,sk);
 
   // Tag = H(K_s,sid,pk,apk,cph)
-  memcpy(hashin+KYBER_SYMBYTES,sid,KYBER_SYMBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES,pk,KYBER_PUBLICKEYBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES,msg1,KYBER_PUBLICKEYBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES,msg2+KYBER_SYMBYTES,KYBER_CIPHERTEXTBYTES);
-  hash_g(keytag,hashin,2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES);
+  transcript_hash(keytag,ss,sid,pk,msg1,msg2+KYBER_SYMBYTES);
 
   // Check tag
   result = verify(keytag+KYBER_SYMBYTES,msg2,KYBER_SYMBYTES);
@@ -113,20 +260,352 @@ void resp(uint8_t key[KYBER_SYMBYTES],
 {
   uint8_t pk[KYBER_PUBLICKEYBYTES];
   uint8_t keytag[2*KYBER_SYMBYTES];
-  uint8_t hashin[2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES];
+  uint8_t ss[KYBER_SYMBYTES];
+  polyvec pkpv;
 
-  hic_inv(pk,msg1,pw,sid);
-  crypto_kem_enc(msg2+KYBER_SYMBYTES,hashin,pk);
+  // pk is packed once, for H(pk) and the transcript; encapsulation
+  // takes the vector part unpacked
+  hic_inv_unpacked(pk,&pkpv,msg1,pw,sid);
+  kem_enc_unpacked(msg2+KYBER_SYMBYTES,ss,pk,&pkpv);
 
   // Tag = H(K_s,sid,pk,apk,cph)
-  memcpy(hashin+KYBER_SYMBYTES,sid,KYBER_SYMBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES,pk,KYBER_PUBLICKEYBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES,msg1,KYBER_PUBLICKEYBYTES);
-  memcpy(hashin+2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES,msg2+KYBER_SYMBYTES,KYBER_CIPHERTEXTBYTES);
-  hash_g(keytag,hashin,2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES);
+  transcript_hash(keytag,ss,sid,pk,msg1,msg2+KYBER_SYMBYTES);
   memcpy(key,keytag,KYBER_SYMBYTES);
   memcpy(msg2,keytag+KYBER_SYMBYTES,KYBER_SYMBYTES);
 
 }
 
+/*************************************************
+* Name:        resp_batch
+*
+* Description: resp for n independent sessions, PAKE_BATCH at a time
+*              in lockstep so that the long hashes (the mask key,
+*              H(pk) of the encapsulation, the transcript) run four
+*              sessions per Keccak call. Outputs are those of n
+*              calls to resp, randomness drawn in the same order
+*
+* Results:   uint8_t (*key): n output keys
+*            uint8_t (*msg2): n output messages
+* 
+* Arguments: uint8_t (*msg1): n input messages
+*            uint8_t (*pw): n passwords
+*            uint8_t (*sid): n sids
+*            size_t n: number of sessions
+* 
+**************************************************/
+void resp_batch(uint8_t (*key)[KYBER_SYMBYTES],
+                uint8_t (*msg2)[MSG2_LEN],
+                const uint8_t (*msg1)[MSG1_LEN],
+                const uint8_t (*pw)[KYBER_SYMBYTES],
+                const uint8_t (*sid)[KYBER_SYMBYTES],
+                size_t n)
+{
+  uint8_t pk[PAKE_BATCH][KYBER_PUBLICKEYBYTES];
+  uint8_t ct[PAKE_BATCH][KYBER_CIPHERTEXTBYTES];
+  uint8_t ss[PAKE_BATCH][KYBER_SYMBYTES];
+  uint8_t keytag[PAKE_BATCH][2*KYBER_SYMBYTES];
+  polyvec pkpv[PAKE_BATCH];
+  size_t i, j, m;
+
+  for(i=0;i<n;i+=m) {
+    m = n-i < PAKE_BATCH ? n-i : PAKE_BATCH;
+    hic_inv_unpacked_xN(pk,pkpv,msg1+i,pw+i,sid+i,m);
+    kem_enc_unpacked_xN(ct,ss,(const uint8_t (*)[KYBER_PUBLICKEYBYTES])pk,pkpv,m);
+    for(j=0;j<m;j++)
+      memcpy(msg2[i+j]+KYBER_SYMBYTES,ct[j],KYBER_CIPHERTEXTBYTES);
+
+    // Tag = H(K_s,sid,pk,apk,cph)
+    transcript_hash_xN(keytag,(const uint8_t (*)[KYBER_SYMBYTES])ss,sid+i,
+                       (const uint8_t (*)[KYBER_PUBLICKEYBYTES])pk,msg1+i,
+                       (const uint8_t (*)[MSG2_LEN])(msg2+i),m);
+    for(j=0;j<m;j++) {
+      memcpy(key[i+j],keytag[j],KYBER_SYMBYTES);
+      memcpy(msg2[i+j],keytag[j]+KYBER_SYMBYTES,KYBER_SYMBYTES);
+    }
+  }
+}
+
+/*************************************************
+* Name:        initEnd_batch
+*
+* Description: initEnd for n independent sessions, with the
+*              transcript hashes four at a time as in resp_batch
+*
+* Results:   uint8_t (*key): n output keys
+*            int *result: n results, 0 if ok, -1 if not ok
+*            return value: 0 if all are ok, -1 otherwise
+* 
+* Arguments: uint8_t (*msg2): n input messages
+*            uint8_t (*msg1): n previously sent messages
+*            uint8_t (*pk): n pk parts of the states
+*            uint8_t (*sk): n sk parts of the states
+*            uint8_t (*sid): n sids
+*            size_t n: number of sessions
+* 
+**************************************************/
+int initEnd_batch(uint8_t (*key)[KYBER_SYMBYTES],
+                  int *result,
+                  const uint8_t (*msg2)[MSG2_LEN],
+                  const uint8_t (*msg1)[MSG1_LEN],
+                  const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                  const uint8_t (*sk)[KYBER_SECRETKEYBYTES],
+                  const uint8_t (*sid)[KYBER_SYMBYTES],
+                  size_t n)
+{
+  int fail = 0;
+  uint8_t keytag[PAKE_BATCH][2*KYBER_SYMBYTES];
+  uint8_t ss[PAKE_BATCH][KYBER_SYMBYTES];
+  size_t i, j, m;
+
+  for(i=0;i<n;i+=m) {
+    m = n-i < PAKE_BATCH ? n-i : PAKE_BATCH;
+    for(j=0;j<m;j++)
+      crypto_kem_dec(ss[j],msg2[i+j]+KYBER_SYMBYTES,sk[i+j]);
+
+    // Tag = H(K_s,sid,pk,apk,cph)
+    transcript_hash_xN(keytag,(const uint8_t (*)[KYBER_SYMBYTES])ss,sid+i,pk+i,msg1+i,msg2+i,m);
+
+    for(j=0;j<m;j++) {
+      // Check tag
+      result[i+j] = verify(keytag[j]+KYBER_SYMBYTES,msg2[i+j],KYBER_SYMBYTES);
+
+      // If all works out
+      cmov(key[i+j],keytag[j],KYBER_SYMBYTES,((uint8_t)result[i+j]&0x1)^0x1);
+      fail |= result[i+j];
+    }
+  }
+  return fail;
+}
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+/*************************************************
+* Name:        initStartPrefix
+*
+* Description: First stage of initiator, keeping only sk and the
+*              absorbed transcript prefix as state
+*
+* Results:     uint8_t *msg1: the outgoing message
+*                 (of length MSG1_LEN)
+*              pake_init_state *st: the initiator state
+* 
+* Arguments:   uint8_t *pw: pointer to the input pw
+*                 (of length KYBER_SYMBYTES)
+*              uint8_t *sid: pointer to the input sid
+*                 (of length KYBER_SYMBYTES)
+* 
+**************************************************/
+void initStartPrefix(uint8_t msg1[MSG1_LEN],
+                     pake_init_state *st,
+                     const uint8_t pw[KYBER_SYMBYTES],
+                     const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t pk[KYBER_PUBLICKEYBYTES];
 
+  initStart(msg1,pk,st->sk,pw,sid);
+  transcript_prefix(&st->transcript,sid,pk,msg1);
+}
+
+/*************************************************
+* Name:        initEndPrefix
+*
+* Description: Last stage of initiator, from the state left by
+*              initStartPrefix: only cph and K_s are hashed
+*
+* Results:   uint8_t *key: pointer to the output key
+*                 (of length KYBER_SYMBYTES)
+*            return value: 0 if ok, -1 of not ok
+* 
+* Arguments: uint8_t *msg2: the input message
+*                 (of length MSG2_LEN)
+*            pake_init_state *st: the initiator state
+* 
+**************************************************/
+int initEndPrefix(uint8_t key[KYBER_SYMBYTES],
+                  const uint8_t msg2[MSG2_LEN],
+                  const pake_init_state *st)
+{
+  int result;
+  uint8_t keytag[2*KYBER_SYMBYTES];
+  uint8_t ss[KYBER_SYMBYTES];
+  keccak_state state = st->transcript;
+
+  crypto_kem_dec(ss,msg2+KYBER_SYMBYTES,st->sk);
+
+  // Tag = H(sid,pk,apk,cph,K_s)
+  transcript_finish(keytag,&state,msg2+KYBER_SYMBYTES,ss);
+
+  // Check tag
+  result = verify(keytag+KYBER_SYMBYTES,msg2,KYBER_SYMBYTES);
+
+  // If all works out
+  cmov(key,keytag,KYBER_SYMBYTES,((uint8_t)result&0x1)^0x1);
+  return result;
+}
+#endif
+
+#ifdef PAKE_COMPACT_STATE
+/*************************************************
+* Name:        initStartCompact
+*
+* Description: First stage of initiator, keeping only the keygen
+*              seed (and pw, or the transcript prefix) as state
+*
+* Results:     uint8_t *msg1: the outgoing message
+*                 (of length MSG1_LEN)
+*              pake_compact_state *st: the initiator state
+* 
+* Arguments:   uint8_t *pw: pointer to the input pw
+*                 (of length KYBER_SYMBYTES)
+*              uint8_t *sid: pointer to the input sid
+*                 (of length KYBER_SYMBYTES)
+* 
+**************************************************/
+void initStartCompact(uint8_t msg1[MSG1_LEN],
+                      pake_compact_state *st,
+                      const uint8_t pw[KYBER_SYMBYTES],
+                      const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t pk[KYBER_PUBLICKEYBYTES];
+  uint8_t sk[KYBER_SECRETKEYBYTES];
+
+  randombytes(st->seed,2*KYBER_SYMBYTES);
+  crypto_kem_keypair_derand(pk,sk,st->seed);
+  hic_eval(msg1,pk,pw,sid);
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  transcript_prefix(&st->transcript,sid,pk,msg1);
+#else
+  memcpy(st->pw,pw,KYBER_SYMBYTES);
+#endif
+}
+
+/*************************************************
+* Name:        initEndCompact
+*
+* Description: Last stage of initiator, from the state left by
+*              initStartCompact: the keypair (and msg1) are
+*              regenerated before decapsulating
+*
+* Results:   uint8_t *key: pointer to the output key
+*                 (of length KYBER_SYMBYTES)
+*            return value: 0 if ok, -1 of not ok
+* 
+* Arguments: uint8_t *msg2: the input message
+*                 (of length MSG2_LEN)
+*            pake_compact_state *st: the initiator state
+*            uint8_t *sid: pointer to the input sid
+*                 (of length KYBER_SYMBYTES)
+* 
+**************************************************/
+int initEndCompact(uint8_t key[KYBER_SYMBYTES],
+                   const uint8_t msg2[MSG2_LEN],
+                   const pake_compact_state *st,
+                   const uint8_t sid[KYBER_SYMBYTES])
+{
+  int result;
+  uint8_t keytag[2*KYBER_SYMBYTES];
+  uint8_t ss[KYBER_SYMBYTES];
+  uint8_t pk[KYBER_PUBLICKEYBYTES];
+  uint8_t sk[KYBER_SECRETKEYBYTES];
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  keccak_state state = st->transcript;
+  (void)sid;
+#else
+  uint8_t msg1[MSG1_LEN];
+#endif
+
+  crypto_kem_keypair_derand(pk,sk,st->seed);
+  crypto_kem_dec(ss,msg2+KYBER_SYMBYTES,sk);
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  // Tag = H(sid,pk,apk,cph,K_s)
+  transcript_finish(keytag,&state,msg2+KYBER_SYMBYTES,ss);
+#else
+  hic_eval(msg1,pk,st->pw,sid);
+
+  // Tag = H(K_s,sid,pk,apk,cph)
+  transcript_hash(keytag,ss,sid,pk,msg1,msg2+KYBER_SYMBYTES);
+#endif
+
+  // Check tag
+  result = verify(keytag+KYBER_SYMBYTES,msg2,KYBER_SYMBYTES);
+
+  // If all works out
+  cmov(key,keytag,KYBER_SYMBYTES,((uint8_t)result&0x1)^0x1);
+  return result;
+}
+#endif
+
+#ifdef PAKE_FAT_STATE
+/*************************************************
+* Name:        initStartFat
+*
+* Description: First stage of initiator, keeping the unpacked
+*              secret key as state
+*
+* Results:     uint8_t *msg1: the outgoing message
+*                 (of length MSG1_LEN)
+*              uint8_t *pk: the pk part of the state
+*                 (of length KYBER_PUBLICKEYBYTES)
+*              kem_fat_sk *sk: the sk part of the state
+* 
+* Arguments:   uint8_t *pw: pointer to the input pw
+*                 (of length KYBER_SYMBYTES)
+*              uint8_t *sid: pointer to the input sid
+*                 (of length KYBER_SYMBYTES)
+* 
+**************************************************/
+void initStartFat(uint8_t msg1[MSG1_LEN],
+                  uint8_t pk[KYBER_PUBLICKEYBYTES],
+                  kem_fat_sk *sk,
+                  const uint8_t pw[KYBER_SYMBYTES],
+                  const uint8_t sid[KYBER_SYMBYTES])
+{
+  kem_fat_keypair(pk,sk);
+  hic_eval(msg1,pk,pw,sid);
+}
+
+/*************************************************
+* Name:        initEndFat
+*
+* Description: Last stage of initiator, from the state left by
+*              initStartFat
+*
+* Results:   uint8_t *key: pointer to the output key
+*                 (of length KYBER_SYMBYTES)
+*            return value: 0 if ok, -1 of not ok
+* 
+* Arguments: uint8_t *msg2: the input message
+*                 (of length MSG2_LEN)
+*            uint8_t *msg1: the previously sent message
+*                 (of length MSG1_LEN)
+*            uint8_t *pk: the pk part of the state
+*                 (of length KYBER_PUBLICKEYBYTES)
+*            kem_fat_sk *sk: the sk part of the state
+*            uint8_t *sid: pointer to the input sid
+*                 (of length KYBER_SYMBYTES)
+* 
+**************************************************/
+int initEndFat(uint8_t key[KYBER_SYMBYTES],
+               const uint8_t msg2[MSG2_LEN],
+               const uint8_t msg1[MSG1_LEN],
+               const uint8_t pk[KYBER_PUBLICKEYBYTES],
+               const kem_fat_sk *sk,
+               const uint8_t sid[KYBER_SYMBYTES])
+{
+  int result;
+  uint8_t keytag[2*KYBER_SYMBYTES];
+  uint8_t ss[KYBER_SYMBYTES];
+
+  kem_fat_dec(ss,msg2+KYBER_SYMBYTES,sk);
+
+  // Tag = H(K_s,sid,pk,apk,cph)
+  transcript_hash(keytag,ss,sid,pk,msg1,msg2+KYBER_SYMBYTES);
+
+  // Check tag
+  result = verify(keytag+KYBER_SYMBYTES,msg2,KYBER_SYMBYTES);
+
+  // If all works out
+  cmov(key,keytag,KYBER_SYMBYTES,((uint8_t)result&0x1)^0x1);
+  return result;
+}
+#endif
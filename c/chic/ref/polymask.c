@@ -0,0 +1,189 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+#include "genx4.h"
+#include "polymask.h"
+#include "poly.h"
+#include "polyvec.h"
+
+/*************************************************
+* Name:        poly_mask_ref
+*
+* Description: Scalar kernel of poly_mask_add/poly_mask_sub: for
+*              sub = 0 r = a + m, for sub = 1 r = a - m, reduced to
+*              [0,q); also writes the coefficients to rp unless NULL
+**************************************************/
+static void poly_mask_ref(uint8_t r[KYBER_POLYBYTES],
+                          poly *rp,
+                          const uint8_t a[KYBER_POLYBYTES],
+                          const poly *m,
+                          int sub)
+{
+  unsigned int i, j;
+  int16_t t[2];
+
+  for(i=0;i<KYBER_N/2;i++) {
+    t[0] = ((a[3*i+0] >> 0) | ((uint16_t)a[3*i+1] << 8)) & 0xFFF;
+    t[1] = ((a[3*i+1] >> 4) | ((uint16_t)a[3*i+2] << 4)) & 0xFFF;
+    for(j=0;j<2;j++) {
+      // in [0,2^12) + [0,q) resp. [0,2^12) - [0,q) + q: in [0,3q)
+      t[j] = sub ? t[j] - m->coeffs[2*i+j] + KYBER_Q : t[j] + m->coeffs[2*i+j];
+      t[j] -= KYBER_Q;
+      t[j] += (t[j] >> 15) & KYBER_Q;
+      t[j] -= KYBER_Q;
+      t[j] += (t[j] >> 15) & KYBER_Q;
+    }
+    r[3*i+0] = (t[0] >> 0);
+    r[3*i+1] = (t[0] >> 8) | (t[1] << 4);
+    r[3*i+2] = (t[1] >> 4);
+    if(rp) {
+      rp->coeffs[2*i+0] = t[0];
+      rp->coeffs[2*i+1] = t[1];
+    }
+  }
+}
+
+#ifdef GENX4
+
+#include <immintrin.h>
+
+#define POLYMASK_TARGET __attribute__((target("avx2")))
+
+/*************************************************
+* Name:        poly_mask_avx2
+*
+* Description: poly_mask_ref sixteen coefficients at a time: 24
+*              bytes are spread over the 16-bit lanes of a ymm and
+*              unpacked to 12 bits, the mask added or subtracted,
+*              the sum brought to [0,q) with two unsigned min(t,t-q)
+*              steps, and the lanes packed back with madd, a byte
+*              shuffle and a dword permute. Loads and stores stay
+*              inside a and r.
+**************************************************/
+POLYMASK_TARGET
+static void poly_mask_avx2(uint8_t r[KYBER_POLYBYTES],
+                           poly *rp,
+                           const uint8_t a[KYBER_POLYBYTES],
+                           const poly *m,
+                           int sub)
+{
+  unsigned int i;
+  const __m256i q = _mm256_set1_epi16(KYBER_Q);
+  const __m256i mask = _mm256_set1_epi16(0xFFF);
+  const __m256i idx8 = _mm256_set_epi8(15,14,14,13,12,11,11,10,
+                                        9, 8, 8, 7, 6, 5, 5, 4,
+                                       11,10,10, 9, 8, 7, 7, 6,
+                                        5, 4, 4, 3, 2, 1, 1, 0);
+  const __m256i pair = _mm256_set1_epi32((1 << 28) | 1);
+  const __m256i pack8 = _mm256_set_epi8(-1,-1,-1,-1,14,13,12,10,
+                                         9, 8, 6, 5, 4, 2, 1, 0,
+                                        -1,-1,-1,-1,14,13,12,10,
+                                         9, 8, 6, 5, 4, 2, 1, 0);
+  const __m256i pack32 = _mm256_set_epi32(7,3,6,5,4,2,1,0);
+  __m256i f, g;
+
+  for(i=0;i<KYBER_N/16;i++) {
+    // the last block is loaded from 8 bytes earlier to stay inside a
+    if(i < KYBER_N/16-1) {
+      f = _mm256_loadu_si256((const __m256i *)&a[24*i]);
+      f = _mm256_permute4x64_epi64(f, 0x94);
+    }
+    else {
+      f = _mm256_loadu_si256((const __m256i *)&a[24*i-8]);
+      f = _mm256_permute4x64_epi64(f, 0xE9);
+    }
+    f = _mm256_shuffle_epi8(f, idx8);
+    g = _mm256_srli_epi16(f, 4);
+    f = _mm256_blend_epi16(f, g, 0xAA);
+    f = _mm256_and_si256(f, mask);
+
+    g = _mm256_loadu_si256((const __m256i *)&m->coeffs[16*i]);
+    if(sub)
+      f = _mm256_add_epi16(_mm256_sub_epi16(f, g), q);
+    else
+      f = _mm256_add_epi16(f, g);
+    f = _mm256_min_epu16(f, _mm256_sub_epi16(f, q));
+    f = _mm256_min_epu16(f, _mm256_sub_epi16(f, q));
+
+    if(rp)
+      _mm256_storeu_si256((__m256i *)&rp->coeffs[16*i], f);
+
+    f = _mm256_madd_epi16(f, pair);
+    f = _mm256_shuffle_epi8(f, pack8);
+    f = _mm256_permutevar8x32_epi32(f, pack32);
+    _mm_storeu_si128((__m128i *)&r[24*i], _mm256_castsi256_si128(f));
+    _mm_storel_epi64((__m128i *)&r[24*i+16], _mm256_extracti128_si256(f, 1));
+  }
+}
+#endif
+
+/*************************************************
+* Name:        poly_mask_add
+*
+* Description: r = pack((unpack(a) + m) mod q)
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (of length KYBER_POLYBYTES bytes)
+*              - const uint8_t *a: pointer to packed input polynomial
+*              - const poly *m: pointer to mask, coefficients in [0,q)
+**************************************************/
+void poly_mask_add(uint8_t r[KYBER_POLYBYTES],
+                   const uint8_t a[KYBER_POLYBYTES],
+                   const poly *m)
+{
+#ifdef GENX4
+  if(genx4_available()) {
+    poly_mask_avx2(r,NULL,a,m,0);
+    return;
+  }
+#endif
+  poly_mask_ref(r,NULL,a,m,0);
+}
+
+/*************************************************
+* Name:        poly_mask_sub
+*
+* Description: r = pack((unpack(a) - m) mod q)
+*
+* Arguments:   - uint8_t *r: pointer to output byte array
+*                            (of length KYBER_POLYBYTES bytes)
+*              - poly *rp: pointer to unpacked output in [0,q),
+*                          or NULL
+*              - const uint8_t *a: pointer to packed input polynomial
+*              - const poly *m: pointer to mask, coefficients in [0,q)
+**************************************************/
+void poly_mask_sub(uint8_t r[KYBER_POLYBYTES],
+                   poly *rp,
+                   const uint8_t a[KYBER_POLYBYTES],
+                   const poly *m)
+{
+#ifdef GENX4
+  if(genx4_available()) {
+    poly_mask_avx2(r,rp,a,m,1);
+    return;
+  }
+#endif
+  poly_mask_ref(r,rp,a,m,1);
+}
+
+void polyvec_mask_add(uint8_t r[KYBER_POLYVECBYTES],
+                      const uint8_t a[KYBER_POLYVECBYTES],
+                      const polyvec *m)
+{
+  unsigned int i;
+
+  for(i=0;i<KYBER_K;i++)
+    poly_mask_add(r+i*KYBER_POLYBYTES,a+i*KYBER_POLYBYTES,&m->vec[i]);
+}
+
+void polyvec_mask_sub(uint8_t r[KYBER_POLYVECBYTES],
+                      polyvec *rp,
+                      const uint8_t a[KYBER_POLYVECBYTES],
+                      const polyvec *m)
+{
+  unsigned int i;
+
+  for(i=0;i<KYBER_K;i++)
+    poly_mask_sub(r+i*KYBER_POLYBYTES,rp ? &rp->vec[i] : NULL,
+                  a+i*KYBER_POLYBYTES,&m->vec[i]);
+}
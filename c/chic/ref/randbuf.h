@@ -0,0 +1,37 @@
+#ifndef RANDBUF_H
+#define RANDBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+
+/*
+  Buffered randombytes: linked instead of the Kyber randombytes.c,
+  randbuf.c serves every randombytes call of a handshake (keygen
+  seeds, encapsulation coins, the initStart nonces) from a per-thread
+  SHAKE256 DRBG instead of one getrandom syscall per call.
+
+  Each thread keeps a 32-byte key and a buffer of output. A refill
+  squeezes SHAKE256(key || counter): the first 32 bytes replace the
+  key (fast key erasure), the rest fill the buffer, and bytes are
+  wiped as they are handed out. The key is reseeded from getrandom
+  on first use and every RANDBUF_RESEED refills, and in a child after
+  fork.
+
+  randbuf_seed switches the calling thread to a deterministic stream
+  (no reseeding), for reproducible benchmark runs; it is not for
+  production keys.
+*/
+
+// refills between reseeds from the OS (about 1 MiB of output)
+#define RANDBUF_RESEED 256
+
+/* deterministic mode for the calling thread, seeded with seed;
+   NULL goes back to OS-seeded mode */
+void randbuf_seed(const uint8_t seed[KYBER_SYMBYTES]);
+
+/* randombytes calls and getrandom syscalls of the calling thread so
+   far */
+void randbuf_stats(uint64_t *calls, uint64_t *syscalls);
+
+#endif
@@ -345,3 +345,268 @@ void xrijndaelDecrypt(xword32 block[], roundkey *rkk)
 
   xKeyAddition(block, block, rp, BC);
 }
+
+/* Specialized Rijndael with 256-bit key and 256-bit block. With BC
+ * and KC fixed to 8 the shift offsets are constants, so ShiftRow,
+ * Substitution and MixColumn of a whole round collapse into four
+ * lookups in the fused tables T0 (T1 for decryption) per column.
+ * Decryption uses the equivalent inverse cipher: InvMixColumn is
+ * applied to the inner round keys once, in xrijndael256DecKeySched,
+ * so that decryption rounds have the same shape as encryption ones. */
+
+#define RK256_ROUNDS 14
+
+void xrijndael256KeySched(const xword32 key[8], xword32 rk[MAXRK])
+{
+  xword8x4 *w = (xword8x4 *) rk;
+  xword8x4 t;
+  int i, j;
+
+  for (j = 0; j < 8; j++) {
+    rk[j] = key[j];
+  }
+  for (i = 1; i <= RK256_ROUNDS; i++, w += 8) {
+    t.w8[0] = xS[w[7].w8[1]] ^ xrcon[i - 1];
+    t.w8[1] = xS[w[7].w8[2]];
+    t.w8[2] = xS[w[7].w8[3]];
+    t.w8[3] = xS[w[7].w8[0]];
+    w[8].w32 = w[0].w32 ^ t.w32;
+    w[9].w32 = w[1].w32 ^ w[8].w32;
+    w[10].w32 = w[2].w32 ^ w[9].w32;
+    w[11].w32 = w[3].w32 ^ w[10].w32;
+    t.w8[0] = xS[w[11].w8[0]];
+    t.w8[1] = xS[w[11].w8[1]];
+    t.w8[2] = xS[w[11].w8[2]];
+    t.w8[3] = xS[w[11].w8[3]];
+    w[12].w32 = w[4].w32 ^ t.w32;
+    w[13].w32 = w[5].w32 ^ w[12].w32;
+    w[14].w32 = w[6].w32 ^ w[13].w32;
+    w[15].w32 = w[7].w32 ^ w[14].w32;
+  }
+}
+
+void xrijndael256DecKeySched(xword32 dk[MAXRK], const xword32 rk[MAXRK])
+{
+  xword32 t[MAXRK];
+  int r, j;
+
+  for (j = 0; j < MAXRK; j++) {
+    t[j] = rk[j];
+  }
+  for (j = 0; j < 8; j++) {
+    dk[j] = t[RK256_ROUNDS * 8 + j];
+    dk[RK256_ROUNDS * 8 + j] = t[j];
+  }
+  for (r = 1; r < RK256_ROUNDS; r++) {
+    xInvMixColumn(dk + 8 * r, t + 8 * (RK256_ROUNDS - r), 8);
+  }
+}
+
+#define TE(s, j) (T0[0][s[(j)].w8[0]].w32 ^ T0[1][s[((j) + 1) & 7].w8[1]].w32 \
+		  ^ T0[2][s[((j) + 3) & 7].w8[2]].w32 ^ T0[3][s[((j) + 4) & 7].w8[3]].w32)
+
+#define TD(s, j) (T1[0][s[(j)].w8[0]].w32 ^ T1[1][s[((j) + 7) & 7].w8[1]].w32 \
+		  ^ T1[2][s[((j) + 5) & 7].w8[2]].w32 ^ T1[3][s[((j) + 4) & 7].w8[3]].w32)
+
+#define ROUND(T, d, s, k) do {			\
+    d[0].w32 = T(s, 0) ^ (k)[0];		\
+    d[1].w32 = T(s, 1) ^ (k)[1];		\
+    d[2].w32 = T(s, 2) ^ (k)[2];		\
+    d[3].w32 = T(s, 3) ^ (k)[3];		\
+    d[4].w32 = T(s, 4) ^ (k)[4];		\
+    d[5].w32 = T(s, 5) ^ (k)[5];		\
+    d[6].w32 = T(s, 6) ^ (k)[6];		\
+    d[7].w32 = T(s, 7) ^ (k)[7];		\
+  } while (0)
+
+/* last round: ShiftRow and Substitution with offsets s1, s2, s3 */
+#define LASTCOL(box, d, s, j, s1, s2, s3) do {		\
+    d[j].w8[0] = box[s[(j)].w8[0]];			\
+    d[j].w8[1] = box[s[((j) + (s1)) & 7].w8[1]];	\
+    d[j].w8[2] = box[s[((j) + (s2)) & 7].w8[2]];	\
+    d[j].w8[3] = box[s[((j) + (s3)) & 7].w8[3]];	\
+  } while (0)
+
+#define LASTROUND(box, d, s, k, s1, s2, s3) do {	\
+    int j_;						\
+    for (j_ = 0; j_ < 8; j_++) {			\
+      LASTCOL(box, d, s, j_, s1, s2, s3);		\
+      d[j_].w32 ^= (k)[j_];				\
+    }							\
+  } while (0)
+
+void xrijndael256Encrypt(xword32 block[8], const xword32 rk[MAXRK])
+{
+  xword8x4 a[8], b[8];
+  int j;
+
+  for (j = 0; j < 8; j++) {
+    a[j].w32 = block[j] ^ rk[j];
+  }
+  ROUND(TE, b, a, rk + 8);
+  ROUND(TE, a, b, rk + 16);
+  ROUND(TE, b, a, rk + 24);
+  ROUND(TE, a, b, rk + 32);
+  ROUND(TE, b, a, rk + 40);
+  ROUND(TE, a, b, rk + 48);
+  ROUND(TE, b, a, rk + 56);
+  ROUND(TE, a, b, rk + 64);
+  ROUND(TE, b, a, rk + 72);
+  ROUND(TE, a, b, rk + 80);
+  ROUND(TE, b, a, rk + 88);
+  ROUND(TE, a, b, rk + 96);
+  ROUND(TE, b, a, rk + 104);
+  LASTROUND(xS, a, b, rk + 112, 1, 3, 4);
+  for (j = 0; j < 8; j++) {
+    block[j] = a[j].w32;
+  }
+}
+
+void xrijndael256Decrypt(xword32 block[8], const xword32 dk[MAXRK])
+{
+  xword8x4 a[8], b[8];
+  int j;
+
+  for (j = 0; j < 8; j++) {
+    a[j].w32 = block[j] ^ dk[j];
+  }
+  ROUND(TD, b, a, dk + 8);
+  ROUND(TD, a, b, dk + 16);
+  ROUND(TD, b, a, dk + 24);
+  ROUND(TD, a, b, dk + 32);
+  ROUND(TD, b, a, dk + 40);
+  ROUND(TD, a, b, dk + 48);
+  ROUND(TD, b, a, dk + 56);
+  ROUND(TD, a, b, dk + 64);
+  ROUND(TD, b, a, dk + 72);
+  ROUND(TD, a, b, dk + 80);
+  ROUND(TD, b, a, dk + 88);
+  ROUND(TD, a, b, dk + 96);
+  ROUND(TD, b, a, dk + 104);
+  LASTROUND(xSi, a, b, dk + 112, 7, 5, 4);
+  for (j = 0; j < 8; j++) {
+    block[j] = a[j].w32;
+  }
+}
+
+/* One-shot variants: the round keys are derived as the rounds go,
+ * in an 8-word window, instead of being written to a 120-word
+ * schedule first. Decryption runs the schedule forward to the last
+ * round key without storing it, then steps it backward and applies
+ * InvMixColumn to each inner round key on the way. */
+
+/* round key i from round key i-1, in place */
+#define NEXTKEY(w, rcon) do {				\
+    xword8x4 t_;					\
+    t_.w8[0] = xS[w[7].w8[1]] ^ (rcon);			\
+    t_.w8[1] = xS[w[7].w8[2]];				\
+    t_.w8[2] = xS[w[7].w8[3]];				\
+    t_.w8[3] = xS[w[7].w8[0]];				\
+    w[0].w32 ^= t_.w32;					\
+    w[1].w32 ^= w[0].w32;				\
+    w[2].w32 ^= w[1].w32;				\
+    w[3].w32 ^= w[2].w32;				\
+    t_.w8[0] = xS[w[3].w8[0]];				\
+    t_.w8[1] = xS[w[3].w8[1]];				\
+    t_.w8[2] = xS[w[3].w8[2]];				\
+    t_.w8[3] = xS[w[3].w8[3]];				\
+    w[4].w32 ^= t_.w32;					\
+    w[5].w32 ^= w[4].w32;				\
+    w[6].w32 ^= w[5].w32;				\
+    w[7].w32 ^= w[6].w32;				\
+  } while (0)
+
+/* round key i-1 from round key i, in place */
+#define PREVKEY(w, rcon) do {				\
+    xword8x4 t_;					\
+    w[7].w32 ^= w[6].w32;				\
+    w[6].w32 ^= w[5].w32;				\
+    w[5].w32 ^= w[4].w32;				\
+    t_.w8[0] = xS[w[3].w8[0]];				\
+    t_.w8[1] = xS[w[3].w8[1]];				\
+    t_.w8[2] = xS[w[3].w8[2]];				\
+    t_.w8[3] = xS[w[3].w8[3]];				\
+    w[4].w32 ^= t_.w32;					\
+    w[3].w32 ^= w[2].w32;				\
+    w[2].w32 ^= w[1].w32;				\
+    w[1].w32 ^= w[0].w32;				\
+    t_.w8[0] = xS[w[7].w8[1]] ^ (rcon);			\
+    t_.w8[1] = xS[w[7].w8[2]];				\
+    t_.w8[2] = xS[w[7].w8[3]];				\
+    t_.w8[3] = xS[w[7].w8[0]];				\
+    w[0].w32 ^= t_.w32;					\
+  } while (0)
+
+#define EROUND(d, s, w, i) do {				\
+    NEXTKEY(w, xrcon[(i) - 1]);				\
+    ROUND(TE, d, s, &w[0].w32);				\
+  } while (0)
+
+#define DROUND(d, s, w, i) do {				\
+    PREVKEY(w, xrcon[i]);				\
+    xInvMixColumn(&dk[0].w32, &w[0].w32, 8);		\
+    ROUND(TD, d, s, &dk[0].w32);			\
+  } while (0)
+
+void xrijndael256EncryptKey(xword32 block[8], const xword32 key[8])
+{
+  xword8x4 a[8], b[8], w[8];
+  int j;
+
+  for (j = 0; j < 8; j++) {
+    w[j].w32 = key[j];
+    a[j].w32 = block[j] ^ key[j];
+  }
+  EROUND(b, a, w, 1);
+  EROUND(a, b, w, 2);
+  EROUND(b, a, w, 3);
+  EROUND(a, b, w, 4);
+  EROUND(b, a, w, 5);
+  EROUND(a, b, w, 6);
+  EROUND(b, a, w, 7);
+  EROUND(a, b, w, 8);
+  EROUND(b, a, w, 9);
+  EROUND(a, b, w, 10);
+  EROUND(b, a, w, 11);
+  EROUND(a, b, w, 12);
+  EROUND(b, a, w, 13);
+  NEXTKEY(w, xrcon[RK256_ROUNDS - 1]);
+  for (j = 0; j < 8; j++) {
+    LASTCOL(xS, a, b, j, 1, 3, 4);
+    block[j] = a[j].w32 ^ w[j].w32;
+  }
+}
+
+void xrijndael256DecryptKey(xword32 block[8], const xword32 key[8])
+{
+  xword8x4 a[8], b[8], w[8], dk[8];
+  int i, j;
+
+  for (j = 0; j < 8; j++) {
+    w[j].w32 = key[j];
+  }
+  for (i = 1; i <= RK256_ROUNDS; i++) {
+    NEXTKEY(w, xrcon[i - 1]);
+  }
+  for (j = 0; j < 8; j++) {
+    a[j].w32 = block[j] ^ w[j].w32;
+  }
+  DROUND(b, a, w, 13);
+  DROUND(a, b, w, 12);
+  DROUND(b, a, w, 11);
+  DROUND(a, b, w, 10);
+  DROUND(b, a, w, 9);
+  DROUND(a, b, w, 8);
+  DROUND(b, a, w, 7);
+  DROUND(a, b, w, 6);
+  DROUND(b, a, w, 5);
+  DROUND(a, b, w, 4);
+  DROUND(b, a, w, 3);
+  DROUND(a, b, w, 2);
+  DROUND(b, a, w, 1);
+  PREVKEY(w, xrcon[0]);
+  for (j = 0; j < 8; j++) {
+    LASTCOL(xSi, a, b, j, 7, 5, 4);
+    block[j] = a[j].w32 ^ w[j].w32;
+  }
+}
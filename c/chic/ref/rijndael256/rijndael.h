@@ -65,4 +65,21 @@ int xrijndaelKeySched(xword32 key[], int keyBits, int blockBits,
 void xrijndaelEncrypt(xword32 block[], roundkey *rkk);
 void xrijndaelDecrypt(xword32 block[], roundkey *rkk);
 
+/* specialized variant for 256-bit key and 256-bit block (BC=KC=8,
+   14 rounds), fully unrolled over fused SubBytes/MixColumn tables.
+   xrijndael256KeySched makes the 120-word encryption schedule without
+   touching key; xrijndael256DecKeySched turns it into the schedule of
+   the equivalent inverse cipher (dk may be rk). */
+
+void xrijndael256KeySched(const xword32 key[8], xword32 rk[MAXRK]);
+void xrijndael256DecKeySched(xword32 dk[MAXRK], const xword32 rk[MAXRK]);
+void xrijndael256Encrypt(xword32 block[8], const xword32 rk[MAXRK]);
+void xrijndael256Decrypt(xword32 block[8], const xword32 dk[MAXRK]);
+
+/* one-shot encrypt, resp. decrypt, of a single block under key: round
+   keys are computed on the fly and no schedule is materialized. */
+
+void xrijndael256EncryptKey(xword32 block[8], const xword32 key[8]);
+void xrijndael256DecryptKey(xword32 block[8], const xword32 key[8]);
+
 #endif				/* __RIJNDAEL_H */
@@ -0,0 +1,535 @@
+/* rijndael_bs.c - bitsliced Rijndael-256/256 for AVX2 */
+
+#include <stdint.h>
+#include "rijndael_bs.h"
+
+#ifdef RIJNDAEL_BS
+
+#include <stdatomic.h>
+#include <immintrin.h>
+
+#define BS_TARGET __attribute__((target("avx2")))
+
+#define ROUNDS 14
+
+typedef __m256i bstate[8];
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define AND(a, b) _mm256_and_si256(a, b)
+#define XNOR(a, b) _mm256_xor_si256(_mm256_xor_si256(a, b), ones)
+
+static atomic_int bs_available = -1;
+
+int xrijndael256bsAvailable(void)
+{
+  int cpu = atomic_load_explicit(&bs_available, memory_order_relaxed);
+
+  if (cpu < 0) {
+    __builtin_cpu_init();
+    cpu = __builtin_cpu_supports("avx2") != 0;
+    atomic_store_explicit(&bs_available, cpu, memory_order_relaxed);
+  }
+  return cpu;
+}
+
+/* Transposition between XRIJNDAEL_BS_LANES blocks of 32 bytes and the
+ * bitsliced state. For each byte position, the eight lane bytes form
+ * an 8x8 bit matrix whose transpose holds one byte per plane. */
+
+static inline uint64_t xTranspose8x8(uint64_t x)
+{
+  uint64_t t;
+
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+BS_TARGET
+static void xPack(bstate q, const xword8 in[XRIJNDAEL_BS_LANES][32])
+{
+  xword8 p[8][32] __attribute__((aligned(32)));
+  uint64_t x;
+  int k, l, b;
+
+  for (k = 0; k < 32; k++) {
+    x = 0;
+    for (l = 0; l < 8; l++) {
+      x |= (uint64_t) in[l][k] << (8 * l);
+    }
+    x = xTranspose8x8(x);
+    for (b = 0; b < 8; b++) {
+      p[b][k] = (xword8) (x >> (8 * b));
+    }
+  }
+  for (b = 0; b < 8; b++) {
+    q[b] = _mm256_load_si256((const __m256i *) p[b]);
+  }
+}
+
+BS_TARGET
+static void xUnpack(xword8 out[XRIJNDAEL_BS_LANES][32], const bstate q)
+{
+  xword8 p[8][32] __attribute__((aligned(32)));
+  uint64_t x;
+  int k, l, b;
+
+  for (b = 0; b < 8; b++) {
+    _mm256_store_si256((__m256i *) p[b], q[b]);
+  }
+  for (k = 0; k < 32; k++) {
+    x = 0;
+    for (b = 0; b < 8; b++) {
+      x |= (uint64_t) p[b][k] << (8 * b);
+    }
+    x = xTranspose8x8(x);
+    for (l = 0; l < 8; l++) {
+      out[l][k] = (xword8) (x >> (8 * l));
+    }
+  }
+}
+
+/* SubBytes: the 113-gate circuit of Boyar and Peralta. Plane 7 holds
+   the most significant bit. */
+
+BS_TARGET
+static void xSubBytes(bstate q)
+{
+  __m256i x0, x1, x2, x3, x4, x5, x6, x7;
+  __m256i y1, y2, y3, y4, y5, y6, y7, y8, y9;
+  __m256i y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+  __m256i y20, y21;
+  __m256i z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+  __m256i z10, z11, z12, z13, z14, z15, z16, z17;
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+  __m256i t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+  __m256i t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+  __m256i t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+  __m256i t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+  __m256i t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+  __m256i t60, t61, t62, t63, t64, t65, t66, t67;
+  __m256i s0, s1, s2, s3, s4, s5, s6, s7;
+  const __m256i ones = _mm256_set1_epi32(-1);
+
+
+  x0 = q[7];
+  x1 = q[6];
+  x2 = q[5];
+  x3 = q[4];
+  x4 = q[3];
+  x5 = q[2];
+  x6 = q[1];
+  x7 = q[0];
+
+  /* top linear transformation */
+  y14 = XOR(x3, x5);
+  y13 = XOR(x0, x6);
+  y9 = XOR(x0, x3);
+  y8 = XOR(x0, x5);
+  t0 = XOR(x1, x2);
+  y1 = XOR(t0, x7);
+  y4 = XOR(y1, x3);
+  y12 = XOR(y13, y14);
+  y2 = XOR(y1, x0);
+  y5 = XOR(y1, x6);
+  y3 = XOR(y5, y8);
+  t1 = XOR(x4, y12);
+  y15 = XOR(t1, x5);
+  y20 = XOR(t1, x1);
+  y6 = XOR(y15, x7);
+  y10 = XOR(y15, t0);
+  y11 = XOR(y20, y9);
+  y7 = XOR(x7, y11);
+  y17 = XOR(y10, y11);
+  y19 = XOR(y10, y8);
+  y16 = XOR(t0, y11);
+  y21 = XOR(y13, y16);
+  y18 = XOR(x0, y16);
+
+  /* non-linear section */
+  t2 = AND(y12, y15);
+  t3 = AND(y3, y6);
+  t4 = XOR(t3, t2);
+  t5 = AND(y4, x7);
+  t6 = XOR(t5, t2);
+  t7 = AND(y13, y16);
+  t8 = AND(y5, y1);
+  t9 = XOR(t8, t7);
+  t10 = AND(y2, y7);
+  t11 = XOR(t10, t7);
+  t12 = AND(y9, y11);
+  t13 = AND(y14, y17);
+  t14 = XOR(t13, t12);
+  t15 = AND(y8, y10);
+  t16 = XOR(t15, t12);
+  t17 = XOR(t4, t14);
+  t18 = XOR(t6, t16);
+  t19 = XOR(t9, t14);
+  t20 = XOR(t11, t16);
+  t21 = XOR(t17, y20);
+  t22 = XOR(t18, y19);
+  t23 = XOR(t19, y21);
+  t24 = XOR(t20, y18);
+
+  t25 = XOR(t21, t22);
+  t26 = AND(t21, t23);
+  t27 = XOR(t24, t26);
+  t28 = AND(t25, t27);
+  t29 = XOR(t28, t22);
+  t30 = XOR(t23, t24);
+  t31 = XOR(t22, t26);
+  t32 = AND(t31, t30);
+  t33 = XOR(t32, t24);
+  t34 = XOR(t23, t33);
+  t35 = XOR(t27, t33);
+  t36 = AND(t24, t35);
+  t37 = XOR(t36, t34);
+  t38 = XOR(t27, t36);
+  t39 = AND(t29, t38);
+  t40 = XOR(t25, t39);
+
+  t41 = XOR(t40, t37);
+  t42 = XOR(t29, t33);
+  t43 = XOR(t29, t40);
+  t44 = XOR(t33, t37);
+  t45 = XOR(t42, t41);
+  z0 = AND(t44, y15);
+  z1 = AND(t37, y6);
+  z2 = AND(t33, x7);
+  z3 = AND(t43, y16);
+  z4 = AND(t40, y1);
+  z5 = AND(t29, y7);
+  z6 = AND(t42, y11);
+  z7 = AND(t45, y17);
+  z8 = AND(t41, y10);
+  z9 = AND(t44, y12);
+  z10 = AND(t37, y3);
+  z11 = AND(t33, y4);
+  z12 = AND(t43, y13);
+  z13 = AND(t40, y5);
+  z14 = AND(t29, y2);
+  z15 = AND(t42, y9);
+  z16 = AND(t45, y14);
+  z17 = AND(t41, y8);
+
+  /* bottom linear transformation */
+  t46 = XOR(z15, z16);
+  t47 = XOR(z10, z11);
+  t48 = XOR(z5, z13);
+  t49 = XOR(z9, z10);
+  t50 = XOR(z2, z12);
+  t51 = XOR(z2, z5);
+  t52 = XOR(z7, z8);
+  t53 = XOR(z0, z3);
+  t54 = XOR(z6, z7);
+  t55 = XOR(z16, z17);
+  t56 = XOR(z12, t48);
+  t57 = XOR(t50, t53);
+  t58 = XOR(z4, t46);
+  t59 = XOR(z3, t54);
+  t60 = XOR(t46, t57);
+  t61 = XOR(z14, t57);
+  t62 = XOR(t52, t58);
+  t63 = XOR(t49, t58);
+  t64 = XOR(z4, t59);
+  t65 = XOR(t61, t62);
+  t66 = XOR(z1, t63);
+  s0 = XOR(t59, t63);
+  s6 = XNOR(t56, t62);
+  s7 = XNOR(t48, t60);
+  t67 = XOR(t64, t65);
+  s3 = XOR(t53, t66);
+  s4 = XOR(t51, t66);
+  s5 = XOR(t47, t65);
+  s1 = XNOR(t64, s3);
+  s2 = XNOR(t55, t67);
+
+  q[7] = s0;
+  q[6] = s1;
+  q[5] = s2;
+  q[4] = s3;
+  q[3] = s4;
+  q[2] = s5;
+  q[1] = s6;
+  q[0] = s7;
+}
+
+/* inverse affine transformation of the S-box, so that
+   InvSubBytes = A^-1 o SubBytes o A^-1 */
+
+BS_TARGET
+static void xInvAffine(bstate q)
+{
+  const __m256i ones = _mm256_set1_epi32(-1);
+  __m256i q0, q1, q2, q3, q4, q5, q6, q7;
+
+  q0 = XOR(q[0], ones);
+  q1 = XOR(q[1], ones);
+  q2 = q[2];
+  q3 = q[3];
+  q4 = q[4];
+  q5 = XOR(q[5], ones);
+  q6 = XOR(q[6], ones);
+  q7 = q[7];
+  q[7] = XOR(XOR(q1, q4), q6);
+  q[6] = XOR(XOR(q0, q3), q5);
+  q[5] = XOR(XOR(q7, q2), q4);
+  q[4] = XOR(XOR(q6, q1), q3);
+  q[3] = XOR(XOR(q5, q0), q2);
+  q[2] = XOR(XOR(q4, q7), q1);
+  q[1] = XOR(XOR(q3, q6), q0);
+  q[0] = XOR(XOR(q2, q5), q7);
+}
+
+BS_TARGET
+static void xInvSubBytes(bstate q)
+{
+  xInvAffine(q);
+  xSubBytes(q);
+  xInvAffine(q);
+}
+
+/* ShiftRow with offsets 0, 1, 3, 4 (resp. their inverses): bytes
+   coming from the other 128-bit lane are blended in first, then one
+   in-lane shuffle puts every byte in place. */
+
+#define SR_BLEND _mm256_setr_epi8(0, -128, -128, -128, 0, 0, -128, -128, \
+				  0, 0, -128, -128, 0, 0, 0, -128,	\
+				  0, -128, -128, -128, 0, 0, -128, -128, \
+				  0, 0, -128, -128, 0, 0, 0, -128)
+#define SR_SHUF  _mm256_setr_epi8(0, 5, 14, 3, 4, 9, 2, 7,		\
+				  8, 13, 6, 11, 12, 1, 10, 15,		\
+				  0, 5, 14, 3, 4, 9, 2, 7,		\
+				  8, 13, 6, 11, 12, 1, 10, 15)
+#define ISR_BLEND _mm256_setr_epi8(0, 0, 0, -128, 0, 0, -128, -128, \
+				   0, 0, -128, -128, 0, -128, -128, -128, \
+				   0, 0, 0, -128, 0, 0, -128, -128,	\
+				   0, 0, -128, -128, 0, -128, -128, -128)
+#define ISR_SHUF  _mm256_setr_epi8(0, 13, 6, 3, 4, 1, 10, 7,		\
+				   8, 5, 14, 11, 12, 9, 2, 15,		\
+				   0, 13, 6, 3, 4, 1, 10, 7,		\
+				   8, 5, 14, 11, 12, 9, 2, 15)
+
+BS_TARGET
+static inline void xShiftRowBs(bstate q, __m256i blend, __m256i shuf)
+{
+  __m256i x;
+  int b;
+
+  for (b = 0; b < 8; b++) {
+    x = _mm256_permute2x128_si256(q[b], q[b], 0x01);
+    x = _mm256_blendv_epi8(q[b], x, blend);
+    q[b] = _mm256_shuffle_epi8(x, shuf);
+  }
+}
+
+/* rotations of the four bytes of every column: row r receives row
+   r+1, resp. r+2 */
+
+#define ROT1 _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8,	\
+			      13, 14, 15, 12, 1, 2, 3, 0, 5, 6, 7, 4,	\
+			      9, 10, 11, 8, 13, 14, 15, 12)
+#define ROT2 _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9,	\
+			      14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5,	\
+			      10, 11, 8, 9, 14, 15, 12, 13)
+
+/* multiplication by x in GF(2^8), on whole planes */
+#define XTIME(r, a) do {			\
+    r[0] = a[7];				\
+    r[1] = XOR(a[0], a[7]);			\
+    r[2] = a[1];				\
+    r[3] = XOR(a[2], a[7]);			\
+    r[4] = XOR(a[3], a[7]);			\
+    r[5] = a[4];				\
+    r[6] = a[5];				\
+    r[7] = a[6];				\
+  } while (0)
+
+BS_TARGET
+static void xMixColumnBs(bstate q)
+{
+  const __m256i rot1 = ROT1;
+  const __m256i rot2 = ROT2;
+  bstate r1, t, xt;
+  int b;
+
+  /* b_r = 2(a_r + a_{r+1}) + a_{r+1} + a_{r+2} + a_{r+3} */
+  for (b = 0; b < 8; b++) {
+    r1[b] = _mm256_shuffle_epi8(q[b], rot1);
+    t[b] = XOR(q[b], r1[b]);
+  }
+  XTIME(xt, t);
+  for (b = 0; b < 8; b++) {
+    q[b] = XOR(XOR(xt[b], r1[b]), _mm256_shuffle_epi8(t[b], rot2));
+  }
+}
+
+BS_TARGET
+static void xInvMixColumnBs(bstate q)
+{
+  const __m256i rot2 = ROT2;
+  bstate t, x2, x4;
+  int b;
+
+  /* InvMixColumn = MixColumn o (a_r += 4(a_r + a_{r+2})) */
+  for (b = 0; b < 8; b++) {
+    t[b] = XOR(q[b], _mm256_shuffle_epi8(q[b], rot2));
+  }
+  XTIME(x2, t);
+  XTIME(x4, x2);
+  for (b = 0; b < 8; b++) {
+    q[b] = XOR(q[b], x4[b]);
+  }
+  xMixColumnBs(q);
+}
+
+BS_TARGET
+static inline void xKeyAdditionBs(bstate q, const bstate k)
+{
+  int b;
+
+  for (b = 0; b < 8; b++) {
+    q[b] = XOR(q[b], k[b]);
+  }
+}
+
+/* next 256-bit round key from the previous one (KC=8):
+ *   w0' = w0 + SubWord(RotWord(w7)) + rcon,  w1'..w3' chained,
+ *   w4' = w4 + SubWord(w3'),                 w5'..w7' chained.
+ * Words 0-3 live in the low 128-bit lane and words 4-7 in the high
+ * one, so the chaining is an in-lane prefix xor. */
+
+#define KS_ROT   _mm256_setr_epi8(13, 14, 15, 12, -1, -1, -1, -1,	\
+				  -1, -1, -1, -1, -1, -1, -1, -1,	\
+				  -1, -1, -1, -1, -1, -1, -1, -1,	\
+				  -1, -1, -1, -1, -1, -1, -1, -1)
+#define KS_SUB   _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,	\
+				  -1, -1, -1, -1, -1, -1, -1, -1,	\
+				  12, 13, 14, 15, -1, -1, -1, -1,	\
+				  -1, -1, -1, -1, -1, -1, -1, -1)
+#define KS_LO    _mm256_setr_epi32(-1, -1, -1, -1, 0, 0, 0, 0)
+#define KS_HI    _mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1)
+#define KS_BYTE0 _mm256_setr_epi32(0xff, 0, 0, 0, 0, 0, 0, 0)
+
+BS_TARGET
+static inline __m256i xPrefixXor(__m256i x)
+{
+  x = XOR(x, _mm256_slli_si256(x, 4));
+  return XOR(x, _mm256_slli_si256(x, 8));
+}
+
+BS_TARGET
+static void xNextRoundKeyBs(bstate k, int rcon)
+{
+  const __m256i rot = KS_ROT;
+  const __m256i sub = KS_SUB;
+  const __m256i lo = KS_LO;
+  const __m256i hi = KS_HI;
+  const __m256i byte0 = KS_BYTE0;
+  bstate s;
+  int b;
+
+  for (b = 0; b < 8; b++) {
+    s[b] = k[b];
+  }
+  xSubBytes(s);
+  for (b = 0; b < 8; b++) {
+    s[b] = _mm256_permute2x128_si256(s[b], s[b], 0x01);
+    s[b] = _mm256_shuffle_epi8(s[b], rot);
+    if ((rcon >> b) & 1) {
+      s[b] = XOR(s[b], byte0);
+    }
+    s[b] = xPrefixXor(AND(XOR(k[b], s[b]), lo));
+    k[b] = AND(k[b], hi);
+  }
+  /* s now holds words 0-3 of the new key, k words 4-7 of the old */
+  for (b = 0; b < 8; b++) {
+    k[b] = XOR(k[b], s[b]);
+  }
+  xSubBytes(s);
+  for (b = 0; b < 8; b++) {
+    s[b] = _mm256_permute2x128_si256(s[b], s[b], 0x01);
+    s[b] = _mm256_shuffle_epi8(s[b], sub);
+    s[b] = XOR(k[b], s[b]);
+    k[b] = _mm256_blend_epi32(k[b], xPrefixXor(AND(s[b], hi)), 0xf0);
+  }
+}
+
+static const int rcons[ROUNDS] = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+  0x80, 0x1b, 0x36, 0x6c, 0xd8, 0xab, 0x4d
+};
+
+/* encryption computes the round keys on the fly */
+
+BS_TARGET
+void xrijndael256bsEncrypt(xword8 block[XRIJNDAEL_BS_LANES][32],
+			   const xword8 key[XRIJNDAEL_BS_LANES][32])
+{
+  bstate q, k;
+  int r;
+
+  xPack(q, (const xword8 (*)[32]) block);
+  xPack(k, key);
+  xKeyAdditionBs(q, k);
+
+  for (r = 1; r < ROUNDS; r++) {
+    xSubBytes(q);
+    xShiftRowBs(q, SR_BLEND, SR_SHUF);
+    xMixColumnBs(q);
+    xNextRoundKeyBs(k, rcons[r - 1]);
+    xKeyAdditionBs(q, k);
+  }
+
+  xSubBytes(q);
+  xShiftRowBs(q, SR_BLEND, SR_SHUF);
+  xNextRoundKeyBs(k, rcons[ROUNDS - 1]);
+  xKeyAdditionBs(q, k);
+
+  xUnpack(block, q);
+}
+
+/* decryption runs the straight inverse cipher from the stored
+   encryption round keys */
+
+BS_TARGET
+void xrijndael256bsDecrypt(xword8 block[XRIJNDAEL_BS_LANES][32],
+			   const xword8 key[XRIJNDAEL_BS_LANES][32])
+{
+  bstate q, k[ROUNDS + 1];
+  int r, b;
+
+  xPack(k[0], key);
+  for (r = 1; r <= ROUNDS; r++) {
+    for (b = 0; b < 8; b++) {
+      k[r][b] = k[r - 1][b];
+    }
+    xNextRoundKeyBs(k[r], rcons[r - 1]);
+  }
+
+  xPack(q, (const xword8 (*)[32]) block);
+  xKeyAdditionBs(q, k[ROUNDS]);
+
+  for (r = ROUNDS - 1; r > 0; r--) {
+    xShiftRowBs(q, ISR_BLEND, ISR_SHUF);
+    xInvSubBytes(q);
+    xKeyAdditionBs(q, k[r]);
+    xInvMixColumnBs(q);
+  }
+
+  xShiftRowBs(q, ISR_BLEND, ISR_SHUF);
+  xInvSubBytes(q);
+  xKeyAdditionBs(q, k[0]);
+
+  xUnpack(block, q);
+}
+
+#else
+
+typedef int xrijndael256bs_unavailable;
+
+#endif				/* RIJNDAEL_BS */
@@ -0,0 +1,37 @@
+/* rijndael_bs.h */
+
+/* Bitsliced, constant-time Rijndael with 256-bit key and 256-bit
+ * block for AVX2. One call processes XRIJNDAEL_BS_LANES independent
+ * (key, block) pairs. The state of all lanes is held in eight 256-bit
+ * registers, one per bit position: byte k of register b collects bit
+ * b of state byte k of every lane. SubBytes is a Boyar-Peralta
+ * circuit, ShiftRows and MixColumn are byte shuffles, and the key
+ * schedule runs bitsliced as well, so no memory access or branch
+ * depends on keys or data.
+ */
+
+#ifndef __RIJNDAEL_BS_H
+#define __RIJNDAEL_BS_H
+
+#include "rijndael.h"
+
+#define XRIJNDAEL_BS_LANES 8
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RIJNDAEL_BS 1
+
+/* returns non-zero iff the running CPU has AVX2 (cached). */
+
+int xrijndael256bsAvailable(void);
+
+/* encrypt, resp. decrypt, block[i] under key[i] for every lane i.
+   Unused lanes must still hold (any) initialized data. */
+
+void xrijndael256bsEncrypt(xword8 block[XRIJNDAEL_BS_LANES][32],
+			   const xword8 key[XRIJNDAEL_BS_LANES][32]);
+void xrijndael256bsDecrypt(xword8 block[XRIJNDAEL_BS_LANES][32],
+			   const xword8 key[XRIJNDAEL_BS_LANES][32]);
+
+#endif
+
+#endif				/* __RIJNDAEL_BS_H */
@@ -0,0 +1,307 @@
+/* rijndael_ni.c - Rijndael-256/256 with AES-NI */
+
+#include "rijndael_ni.h"
+
+#ifdef RIJNDAEL_NI
+
+#include <stdatomic.h>
+#include <immintrin.h>
+
+#define NI_TARGET __attribute__((target("aes,sse4.1")))
+
+#define ROUNDS 14
+
+/* The 256-bit state is split in two halves (columns 0-3 and 4-7).
+ * Before each AES round instruction, bytes whose Rijndael-256
+ * ShiftRows source lives in the other half are swapped in with a
+ * blend, and a byte shuffle pre-compensates for the 128-bit
+ * (Inv)ShiftRows that the instruction itself performs. Because the
+ * Rijndael-256 row shifts are symmetric under a 4-column rotation,
+ * the same blend mask and shuffle serve both halves. */
+
+#define ENC_BLEND _mm_setr_epi8(0, -128, -128, -128, 0, 0, -128, -128, \
+                                0, 0, -128, -128, 0, 0, 0, -128)
+#define ENC_SHUF  _mm_setr_epi8(0, 1, 6, 7, 4, 5, 10, 11, \
+                                8, 9, 14, 15, 12, 13, 2, 3)
+#define DEC_BLEND _mm_setr_epi8(0, 0, 0, -128, 0, 0, -128, -128, \
+                                0, 0, -128, -128, 0, -128, -128, -128)
+#define DEC_SHUF  _mm_setr_epi8(0, 1, 14, 15, 4, 5, 2, 3, \
+                                8, 9, 6, 7, 12, 13, 10, 11)
+
+static atomic_int ni_available = -1;
+
+int xrijndael256niAvailable(void)
+{
+  int cpu = atomic_load_explicit(&ni_available, memory_order_relaxed);
+
+  if (cpu < 0) {
+    __builtin_cpu_init();
+    cpu = __builtin_cpu_supports("aes")
+      && __builtin_cpu_supports("sse4.1");
+    atomic_store_explicit(&ni_available, cpu, memory_order_relaxed);
+  }
+  return cpu;
+}
+
+/* AES-256 key expansion step: KC=8 as in Rijndael-256/256, only the
+   number of generated words differs. */
+
+NI_TARGET
+static inline __m128i xExpandLo(__m128i lo, __m128i assist)
+{
+  assist = _mm_shuffle_epi32(assist, 0xff);
+  lo = _mm_xor_si128(lo, _mm_slli_si128(lo, 4));
+  lo = _mm_xor_si128(lo, _mm_slli_si128(lo, 8));
+  return _mm_xor_si128(lo, assist);
+}
+
+NI_TARGET
+static inline __m128i xExpandHi(__m128i hi, __m128i lo)
+{
+  __m128i assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(lo, 0), 0xaa);
+  hi = _mm_xor_si128(hi, _mm_slli_si128(hi, 4));
+  hi = _mm_xor_si128(hi, _mm_slli_si128(hi, 8));
+  return _mm_xor_si128(hi, assist);
+}
+
+#define EXPAND(i, rcon) do {                                       \
+    lo = xExpandLo(lo, _mm_aeskeygenassist_si128(hi, rcon));       \
+    hi = xExpandHi(hi, lo);                                        \
+    _mm_storeu_si128(rp + 2*(i), lo);                              \
+    _mm_storeu_si128(rp + 2*(i) + 1, hi);                          \
+  } while (0)
+
+NI_TARGET
+void xrijndael256niKeySched(const xword32 key[8], xword32 rk[MAXRK])
+{
+  __m128i *rp = (__m128i *) rk;
+  __m128i lo = _mm_loadu_si128((const __m128i *) key);
+  __m128i hi = _mm_loadu_si128((const __m128i *) key + 1);
+
+  _mm_storeu_si128(rp, lo);
+  _mm_storeu_si128(rp + 1, hi);
+  EXPAND(1, 0x01);
+  EXPAND(2, 0x02);
+  EXPAND(3, 0x04);
+  EXPAND(4, 0x08);
+  EXPAND(5, 0x10);
+  EXPAND(6, 0x20);
+  EXPAND(7, 0x40);
+  EXPAND(8, 0x80);
+  EXPAND(9, 0x1b);
+  EXPAND(10, 0x36);
+  EXPAND(11, 0x6c);
+  EXPAND(12, 0xd8);
+  EXPAND(13, 0xab);
+  EXPAND(14, 0x4d);
+}
+
+NI_TARGET
+void xrijndael256niDecKeySched(xword32 dk[MAXRK], const xword32 rk[MAXRK])
+{
+  const __m128i *rp = (const __m128i *) rk;
+  __m128i *dp = (__m128i *) dk;
+  __m128i t[2 * (ROUNDS + 1)];
+  int r;
+
+  for (r = 0; r < 2 * (ROUNDS + 1); r++) {
+    t[r] = _mm_loadu_si128(rp + r);
+  }
+  _mm_storeu_si128(dp, t[2 * ROUNDS]);
+  _mm_storeu_si128(dp + 1, t[2 * ROUNDS + 1]);
+  for (r = 1; r < ROUNDS; r++) {
+    _mm_storeu_si128(dp + 2 * r, _mm_aesimc_si128(t[2 * (ROUNDS - r)]));
+    _mm_storeu_si128(dp + 2 * r + 1, _mm_aesimc_si128(t[2 * (ROUNDS - r) + 1]));
+  }
+  _mm_storeu_si128(dp + 2 * ROUNDS, t[0]);
+  _mm_storeu_si128(dp + 2 * ROUNDS + 1, t[1]);
+}
+
+NI_TARGET
+void xrijndael256niEncrypt(xword32 block[8], const xword32 rk[MAXRK])
+{
+  const __m128i *rp = (const __m128i *) rk;
+  const __m128i blend = ENC_BLEND;
+  const __m128i shuf = ENC_SHUF;
+  __m128i d0, d1, t0, t1;
+  int r;
+
+  d0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block), _mm_loadu_si128(rp));
+  d1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block + 1), _mm_loadu_si128(rp + 1));
+
+  for (r = 1; r < ROUNDS; r++) {
+    t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+    t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+    d0 = _mm_aesenc_si128(t0, _mm_loadu_si128(rp + 2 * r));
+    d1 = _mm_aesenc_si128(t1, _mm_loadu_si128(rp + 2 * r + 1));
+  }
+
+  t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+  t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+  d0 = _mm_aesenclast_si128(t0, _mm_loadu_si128(rp + 2 * ROUNDS));
+  d1 = _mm_aesenclast_si128(t1, _mm_loadu_si128(rp + 2 * ROUNDS + 1));
+
+  _mm_storeu_si128((__m128i *) block, d0);
+  _mm_storeu_si128((__m128i *) block + 1, d1);
+}
+
+NI_TARGET
+void xrijndael256niDecrypt(xword32 block[8], const xword32 dk[MAXRK])
+{
+  const __m128i *dp = (const __m128i *) dk;
+  const __m128i blend = DEC_BLEND;
+  const __m128i shuf = DEC_SHUF;
+  __m128i d0, d1, t0, t1;
+  int r;
+
+  d0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block), _mm_loadu_si128(dp));
+  d1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block + 1), _mm_loadu_si128(dp + 1));
+
+  for (r = 1; r < ROUNDS; r++) {
+    t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+    t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+    d0 = _mm_aesdec_si128(t0, _mm_loadu_si128(dp + 2 * r));
+    d1 = _mm_aesdec_si128(t1, _mm_loadu_si128(dp + 2 * r + 1));
+  }
+
+  t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+  t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+  d0 = _mm_aesdeclast_si128(t0, _mm_loadu_si128(dp + 2 * ROUNDS));
+  d1 = _mm_aesdeclast_si128(t1, _mm_loadu_si128(dp + 2 * ROUNDS + 1));
+
+  _mm_storeu_si128((__m128i *) block, d0);
+  _mm_storeu_si128((__m128i *) block + 1, d1);
+}
+
+/* One-shot variants, round keys computed on the fly. For decryption
+   the expansion is first run forward to the last round key without
+   storing anything, then inverted step by step: the chained xor of
+   xExpandLo/xExpandHi is undone by x ^ (x << 32). */
+
+NI_TARGET
+static inline __m128i xUnchain(__m128i x)
+{
+  return _mm_xor_si128(x, _mm_slli_si128(x, 4));
+}
+
+#define STEP(rcon) do {                                            \
+    lo = xExpandLo(lo, _mm_aeskeygenassist_si128(hi, rcon));       \
+    hi = xExpandHi(hi, lo);                                        \
+  } while (0)
+
+#define UNSTEP(rcon) do {                                          \
+    hi = xUnchain(_mm_xor_si128(hi, _mm_shuffle_epi32(             \
+           _mm_aeskeygenassist_si128(lo, 0), 0xaa)));              \
+    lo = xUnchain(_mm_xor_si128(lo, _mm_shuffle_epi32(             \
+           _mm_aeskeygenassist_si128(hi, rcon), 0xff)));           \
+  } while (0)
+
+#define ENCROUND(rcon) do {                                        \
+    STEP(rcon);                                                    \
+    t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);   \
+    t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);   \
+    d0 = _mm_aesenc_si128(t0, lo);                                 \
+    d1 = _mm_aesenc_si128(t1, hi);                                 \
+  } while (0)
+
+/* round r uses round key r, obtained by UNSTEP with rcon r+1 */
+#define DECROUND(rcon) do {                                        \
+    UNSTEP(rcon);                                                  \
+    t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);   \
+    t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);   \
+    d0 = _mm_aesdec_si128(t0, _mm_aesimc_si128(lo));               \
+    d1 = _mm_aesdec_si128(t1, _mm_aesimc_si128(hi));               \
+  } while (0)
+
+NI_TARGET
+void xrijndael256niEncryptKey(xword32 block[8], const xword32 key[8])
+{
+  const __m128i blend = ENC_BLEND;
+  const __m128i shuf = ENC_SHUF;
+  __m128i lo = _mm_loadu_si128((const __m128i *) key);
+  __m128i hi = _mm_loadu_si128((const __m128i *) key + 1);
+  __m128i d0, d1, t0, t1;
+
+  d0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block), lo);
+  d1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block + 1), hi);
+
+  ENCROUND(0x01);
+  ENCROUND(0x02);
+  ENCROUND(0x04);
+  ENCROUND(0x08);
+  ENCROUND(0x10);
+  ENCROUND(0x20);
+  ENCROUND(0x40);
+  ENCROUND(0x80);
+  ENCROUND(0x1b);
+  ENCROUND(0x36);
+  ENCROUND(0x6c);
+  ENCROUND(0xd8);
+  ENCROUND(0xab);
+
+  STEP(0x4d);
+  t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+  t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+  d0 = _mm_aesenclast_si128(t0, lo);
+  d1 = _mm_aesenclast_si128(t1, hi);
+
+  _mm_storeu_si128((__m128i *) block, d0);
+  _mm_storeu_si128((__m128i *) block + 1, d1);
+}
+
+NI_TARGET
+void xrijndael256niDecryptKey(xword32 block[8], const xword32 key[8])
+{
+  const __m128i blend = DEC_BLEND;
+  const __m128i shuf = DEC_SHUF;
+  __m128i lo = _mm_loadu_si128((const __m128i *) key);
+  __m128i hi = _mm_loadu_si128((const __m128i *) key + 1);
+  __m128i d0, d1, t0, t1;
+
+  STEP(0x01);
+  STEP(0x02);
+  STEP(0x04);
+  STEP(0x08);
+  STEP(0x10);
+  STEP(0x20);
+  STEP(0x40);
+  STEP(0x80);
+  STEP(0x1b);
+  STEP(0x36);
+  STEP(0x6c);
+  STEP(0xd8);
+  STEP(0xab);
+  STEP(0x4d);
+
+  d0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block), lo);
+  d1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) block + 1), hi);
+
+  DECROUND(0x4d);
+  DECROUND(0xab);
+  DECROUND(0xd8);
+  DECROUND(0x6c);
+  DECROUND(0x36);
+  DECROUND(0x1b);
+  DECROUND(0x80);
+  DECROUND(0x40);
+  DECROUND(0x20);
+  DECROUND(0x10);
+  DECROUND(0x08);
+  DECROUND(0x04);
+  DECROUND(0x02);
+
+  UNSTEP(0x01);
+  t0 = _mm_shuffle_epi8(_mm_blendv_epi8(d0, d1, blend), shuf);
+  t1 = _mm_shuffle_epi8(_mm_blendv_epi8(d1, d0, blend), shuf);
+  d0 = _mm_aesdeclast_si128(t0, lo);
+  d1 = _mm_aesdeclast_si128(t1, hi);
+
+  _mm_storeu_si128((__m128i *) block, d0);
+  _mm_storeu_si128((__m128i *) block + 1, d1);
+}
+
+#else
+
+typedef int xrijndael256ni_unavailable;
+
+#endif				/* RIJNDAEL_NI */
@@ -0,0 +1,50 @@
+/* rijndael_ni.h */
+
+/* Rijndael with 256-bit key and 256-bit block on top of the x86
+ * AES-NI instructions. The state is kept as two 128-bit halves: the
+ * byte blend/shuffle in front of every AESENC/AESDEC turns the
+ * 128-bit ShiftRows done by the instruction into the Rijndael-256
+ * one (row offsets 0, 1, 3, 4), so each round costs two AES
+ * instructions plus three shuffles on each half.
+ *
+ * Round keys use the same memory layout as the rk[] field of the
+ * ccrypt roundkey structure, so either key schedule can feed either
+ * cipher.
+ */
+
+#ifndef __RIJNDAEL_NI_H
+#define __RIJNDAEL_NI_H
+
+#include "rijndael.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RIJNDAEL_NI 1
+
+/* returns non-zero iff the running CPU has AES-NI and SSE4.1. The
+   result is computed once and cached. */
+
+int xrijndael256niAvailable(void);
+
+/* make the 15 encryption round keys (120 words) from a 256-bit key.
+   Unlike xrijndaelKeySched, key is not modified. */
+
+void xrijndael256niKeySched(const xword32 key[8], xword32 rk[MAXRK]);
+
+/* turn encryption round keys into decryption round keys for the
+   equivalent inverse cipher (reverse order, InvMixColumn applied to
+   the inner ones). dk may be rk. */
+
+void xrijndael256niDecKeySched(xword32 dk[MAXRK], const xword32 rk[MAXRK]);
+
+void xrijndael256niEncrypt(xword32 block[8], const xword32 rk[MAXRK]);
+void xrijndael256niDecrypt(xword32 block[8], const xword32 dk[MAXRK]);
+
+/* one-shot single-block encrypt, resp. decrypt, under key with the
+   round keys computed on the fly (see xrijndael256EncryptKey). */
+
+void xrijndael256niEncryptKey(xword32 block[8], const xword32 key[8]);
+void xrijndael256niDecryptKey(xword32 block[8], const xword32 key[8]);
+
+#endif
+
+#endif				/* __RIJNDAEL_NI_H */
@@ -9,6 +9,8 @@
 
 extern xword8x4 M0[4][256];
 extern xword8x4 M1[4][256];
+extern xword8x4 T0[4][256];
+extern xword8x4 T1[4][256];
 extern int xrcon[30];
 extern xword8 xS[256];
 extern xword8 xSi[256];
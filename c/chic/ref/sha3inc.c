@@ -0,0 +1,131 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sha3inc.h"
+#include "keccakf1600.h"
+
+static uint64_t load64(const uint8_t x[8])
+{
+  unsigned int i;
+  uint64_t r = 0;
+
+  for(i=0;i<8;i++)
+    r |= (uint64_t)x[i] << 8*i;
+  return r;
+}
+
+static void keccak_inc_init(keccak_state *state)
+{
+  memset(state->s, 0, sizeof(state->s));
+  state->pos = 0;
+}
+
+static void keccak_inc_absorb(keccak_state *state, unsigned int r,
+                              const uint8_t *in, size_t inlen)
+{
+  unsigned int pos = state->pos;
+  uint64_t *s = state->s;
+  unsigned int i;
+
+  // finish a partial block byte by byte
+  while(pos % 8 && inlen) {
+    s[pos/8] ^= (uint64_t)*in++ << 8*(pos%8);
+    pos++;
+    inlen--;
+    if(pos == r) {
+      KeccakF1600_StatePermute_fast(s);
+      pos = 0;
+    }
+  }
+
+  // whole words, one permutation per r bytes
+  while(inlen >= 8) {
+    if(pos == 0) {
+      while(inlen >= r) {
+        for(i=0;i<r/8;i++)
+          s[i] ^= load64(in+8*i);
+        KeccakF1600_StatePermute_fast(s);
+        in += r;
+        inlen -= r;
+      }
+      if(inlen < 8)
+        break;
+    }
+    s[pos/8] ^= load64(in);
+    pos += 8;
+    in += 8;
+    inlen -= 8;
+    if(pos == r) {
+      KeccakF1600_StatePermute_fast(s);
+      pos = 0;
+    }
+  }
+
+  for(i=0;i<inlen;i++)
+    s[(pos+i)/8] ^= (uint64_t)in[i] << 8*((pos+i)%8);
+  state->pos = pos + inlen;
+}
+
+static void keccak_inc_finalize(uint8_t *h, size_t hlen, keccak_state *state,
+                                unsigned int r)
+{
+  unsigned int pos = state->pos;
+  uint64_t *s = state->s;
+  size_t i;
+
+  // SHA3 domain separation and pad10*1
+  s[pos/8] ^= (uint64_t)0x06 << 8*(pos%8);
+  s[r/8-1] ^= 1ULL << 63;
+  KeccakF1600_StatePermute_fast(s);
+
+  for(i=0;i<hlen;i++)
+    h[i] = s[i/8] >> 8*(i%8);
+}
+
+void sha3_256_inc_init(keccak_state *state)
+{
+  keccak_inc_init(state);
+}
+
+void sha3_256_inc_absorb(keccak_state *state, const uint8_t *in, size_t inlen)
+{
+  keccak_inc_absorb(state, SHA3_256_RATE, in, inlen);
+}
+
+void sha3_256_inc_finalize(uint8_t h[32], keccak_state *state)
+{
+  keccak_inc_finalize(h, 32, state, SHA3_256_RATE);
+}
+
+void sha3_512_inc_init(keccak_state *state)
+{
+  keccak_inc_init(state);
+}
+
+void sha3_512_inc_absorb(keccak_state *state, const uint8_t *in, size_t inlen)
+{
+  keccak_inc_absorb(state, SHA3_512_RATE, in, inlen);
+}
+
+void sha3_512_inc_finalize(uint8_t h[64], keccak_state *state)
+{
+  keccak_inc_finalize(h, 64, state, SHA3_512_RATE);
+}
+
+void sha3_256_fast(uint8_t h[32], const uint8_t *in, size_t inlen)
+{
+  keccak_state state;
+
+  keccak_inc_init(&state);
+  keccak_inc_absorb(&state, SHA3_256_RATE, in, inlen);
+  keccak_inc_finalize(h, 32, &state, SHA3_256_RATE);
+}
+
+void sha3_512_fast(uint8_t h[64], const uint8_t *in, size_t inlen)
+{
+  keccak_state state;
+
+  keccak_inc_init(&state);
+  keccak_inc_absorb(&state, SHA3_512_RATE, in, inlen);
+  keccak_inc_finalize(h, 64, &state, SHA3_512_RATE);
+}
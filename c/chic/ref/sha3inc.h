@@ -0,0 +1,61 @@
+#ifndef SHA3INC_H
+#define SHA3INC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fips202.h"
+
+/*
+  Incremental SHA3-256/SHA3-512 (init/absorb/finalize), so that
+  hash inputs can be absorbed straight from where they live instead
+  of being copied into one contiguous buffer first. The state type
+  is the Kyber keccak_state; the output matches sha3_256/sha3_512
+  over the concatenation of everything absorbed. The permutation is
+  the unrolled one of keccakf1600.c.
+*/
+
+void sha3_256_inc_init(keccak_state *state);
+void sha3_256_inc_absorb(keccak_state *state, const uint8_t *in, size_t inlen);
+void sha3_256_inc_finalize(uint8_t h[32], keccak_state *state);
+
+void sha3_512_inc_init(keccak_state *state);
+void sha3_512_inc_absorb(keccak_state *state, const uint8_t *in, size_t inlen);
+void sha3_512_inc_finalize(uint8_t h[64], keccak_state *state);
+
+// incremental counterparts of hash_h and hash_g in symmetric.h
+#define hash_h_init(STATE) sha3_256_inc_init(STATE)
+#define hash_h_absorb(STATE, IN, INBYTES) sha3_256_inc_absorb(STATE, IN, INBYTES)
+#define hash_h_final(OUT, STATE) sha3_256_inc_finalize(OUT, STATE)
+#define hash_g_init(STATE) sha3_512_inc_init(STATE)
+#define hash_g_absorb(STATE, IN, INBYTES) sha3_512_inc_absorb(STATE, IN, INBYTES)
+#define hash_g_final(OUT, STATE) sha3_512_inc_finalize(OUT, STATE)
+
+// one-shot hash_h and hash_g on the same permutation
+void sha3_256_fast(uint8_t h[32], const uint8_t *in, size_t inlen);
+void sha3_512_fast(uint8_t h[64], const uint8_t *in, size_t inlen);
+
+#define pake_hash_h(OUT, IN, INBYTES) sha3_256_fast(OUT, IN, INBYTES)
+#define pake_hash_g(OUT, IN, INBYTES) sha3_512_fast(OUT, IN, INBYTES)
+
+/*
+  The password-masking hashes of hic.c and twofeistel.c. SHA3 as
+  above, or with PAKE_TURBOSHAKE TurboSHAKE256 with 32 resp. 64
+  bytes of output under their own domain bytes (turboshake.h). Both
+  peers have to agree on the variant.
+*/
+#ifdef PAKE_TURBOSHAKE
+#include "turboshake.h"
+#define mask_hash_h_init(STATE) turboshake256_init(STATE)
+#define mask_hash_h_absorb(STATE, IN, INBYTES) turboshake256_absorb(STATE, IN, INBYTES)
+#define mask_hash_h_final(OUT, STATE) turboshake256_final(OUT, 32, STATE, TURBOSHAKE_DS_HASH_H)
+#define mask_hash_h(OUT, IN, INBYTES) turboshake256(OUT, 32, IN, INBYTES, TURBOSHAKE_DS_HASH_H)
+#define mask_hash_g(OUT, IN, INBYTES) turboshake256(OUT, 64, IN, INBYTES, TURBOSHAKE_DS_HASH_G)
+#else
+#define mask_hash_h_init(STATE) hash_h_init(STATE)
+#define mask_hash_h_absorb(STATE, IN, INBYTES) hash_h_absorb(STATE, IN, INBYTES)
+#define mask_hash_h_final(OUT, STATE) hash_h_final(OUT, STATE)
+#define mask_hash_h(OUT, IN, INBYTES) pake_hash_h(OUT, IN, INBYTES)
+#define mask_hash_g(OUT, IN, INBYTES) pake_hash_g(OUT, IN, INBYTES)
+#endif
+
+#endif
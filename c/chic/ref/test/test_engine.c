@@ -0,0 +1,153 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include "../pake.h"
+#include "../respengine.h"
+#include "kem.h"
+#include "randombytes.h"
+
+#define NJOBS 4000
+#define NSESSIONS 64
+// every NCHECK-th response is checked with initEnd
+#define NCHECK 16
+
+/*
+  Load generator for the responder engine: submits NJOBS msg1s as
+  fast as back-pressure lets it (at most 2*threads*batch in flight)
+  and reports handshakes per second and the p50/p99 latency from
+  submission to completion callback, for 1, 2, 4, ... threads up to
+  the number of CPUs (or the first argument), with resp and with
+  resp_batch. A sample of the responses is checked with initEnd.
+*/
+
+typedef struct {
+  respengine_job job;
+  struct timespec submitted;
+  double latency;
+} engine_job;
+
+static uint8_t sid[NSESSIONS][CRYPTO_BYTES];
+static uint8_t pw[NSESSIONS][CRYPTO_BYTES];
+static uint8_t sk[NSESSIONS][CRYPTO_SECRETKEYBYTES];
+static uint8_t pk[NSESSIONS][CRYPTO_PUBLICKEYBYTES];
+static uint8_t msg1[NSESSIONS][MSG1_LEN];
+
+static double elapsed(const struct timespec *a, const struct timespec *b)
+{
+  return (double)(b->tv_sec - a->tv_sec) + 1e-9*(double)(b->tv_nsec - a->tv_nsec);
+}
+
+static void engine_done(respengine_job *job)
+{
+  engine_job *j = job->arg;
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  j->latency = elapsed(&j->submitted, &now);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static int run(engine_job *jobs, double *lat,
+               unsigned int nthreads, unsigned int batch)
+{
+  respengine *e;
+  struct timespec start, stop;
+  uint64_t completed, rejected, stolen;
+  uint8_t key[CRYPTO_BYTES];
+  unsigned int i, s;
+
+  e = respengine_new(nthreads, 2*nthreads*batch, batch, 1);
+  if(e == NULL) {
+    printf("ERROR respengine_new\n");
+    return 1;
+  }
+
+  for(i=0;i<NJOBS;i++) {
+    s = i % NSESSIONS;
+    memcpy(jobs[i].job.msg1,msg1[s],MSG1_LEN);
+    memcpy(jobs[i].job.pw,pw[s],CRYPTO_BYTES);
+    memcpy(jobs[i].job.sid,sid[s],CRYPTO_BYTES);
+    jobs[i].job.done = engine_done;
+    jobs[i].job.arg = &jobs[i];
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i=0;i<NJOBS;i++) {
+    clock_gettime(CLOCK_MONOTONIC, &jobs[i].submitted);
+    while(respengine_submit(e,&jobs[i].job))
+      sched_yield();
+  }
+  respengine_drain(e);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  respengine_stats(e,&completed,&rejected,&stolen);
+  respengine_free(e);
+
+  if(completed != NJOBS) {
+    printf("ERROR respengine completed %llu of %d\n",(unsigned long long)completed,NJOBS);
+    return 1;
+  }
+  for(i=0;i<NJOBS;i+=NCHECK) {
+    s = i % NSESSIONS;
+    if(initEnd(key,jobs[i].job.msg2,msg1[s],pk[s],sk[s],sid[s]) ||
+       memcmp(key,jobs[i].job.key,CRYPTO_BYTES)) {
+      printf("ERROR respengine key\n");
+      return 1;
+    }
+  }
+
+  for(i=0;i<NJOBS;i++)
+    lat[i] = jobs[i].latency;
+  qsort(lat,NJOBS,sizeof(double),cmp_double);
+  printf("threads %2u batch %u: %9.0f handshakes/s  p50 %8.1f us  p99 %8.1f us  stolen %llu\n",
+         nthreads, batch, NJOBS/elapsed(&start,&stop),
+         1e6*lat[NJOBS/2], 1e6*lat[NJOBS*99/100], (unsigned long long)stolen);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  engine_job *jobs;
+  double *lat;
+  unsigned int i, n, maxthreads;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int r = 0;
+
+  maxthreads = argc > 1 ? (unsigned int)atoi(argv[1]) : (ncpu > 0 ? (unsigned int)ncpu : 1);
+  if(maxthreads == 0)
+    maxthreads = 1;
+
+  for(i=0;i<NSESSIONS;i++) {
+    randombytes(pw[i],CRYPTO_BYTES);
+    randombytes(sid[i],CRYPTO_BYTES);
+    initStart(msg1[i],pk[i],sk[i],pw[i],sid[i]);
+  }
+
+  jobs = malloc(NJOBS*sizeof(engine_job));
+  lat = malloc(NJOBS*sizeof(double));
+  if(jobs == NULL || lat == NULL)
+    return 1;
+
+  printf("KYBER_K=%d, %d handshakes per run\n", KYBER_K, NJOBS);
+  for(n=1;;n*=2) {
+    if(n > maxthreads)
+      n = maxthreads;
+    r |= run(jobs,lat,n,1);
+    r |= run(jobs,lat,n,PAKE_BATCH);
+    if(r || n == maxthreads)
+      break;
+  }
+
+  free(jobs);
+  free(lat);
+  return r;
+}
@@ -3,13 +3,56 @@
 #include <string.h>
 #include "../hic.h"
 #include "../pake.h"
+#include "../kemfat.h"
+#include "../genx4.h"
+#include "../rejavx2.h"
+#include "../polymask.h"
+#include "../sha3inc.h"
+#include "../keccakf1600.h"
+#include "indcpa.h"
+#include "rej_uniform.h"
+#ifdef GENAES_VECTOR
+#include "evp_ref.h"
+#endif
 #include "kem.h"
 #include "randombytes.h"
+#ifdef PAKE_RANDBUF
+#include "../randbuf.h"
+#endif
 
 #define NTESTS 1000
 
 static int test_hic(void);
+static int test_hic_xN(void);
+static int test_genx4(void);
+static int test_rejavx2(void);
+static int test_keccak(void);
+#ifdef PAKE_TURBOSHAKE
+static int test_turboshake(void);
+#endif
+static int test_polymask(void);
+#ifdef GENAES_VECTOR
+static int test_genaes(void);
+#endif
+static int test_kem_unpacked(void);
 static int test_pake(void);
+static int test_pake_batch(void);
+#ifdef PAKE_TRANSCRIPT_PREFIX
+static int test_pake_prefix(void);
+#endif
+#ifdef PAKE_KEYPOOL
+static int test_pake_pool(keypool *pool);
+#endif
+#ifdef PAKE_RANDBUF
+static int test_randbuf(void);
+#endif
+#ifdef PAKE_COMPACT_STATE
+static int test_pake_compact(void);
+#endif
+#ifdef PAKE_FAT_STATE
+static int test_kem_fat(void);
+static int test_pake_fat(void);
+#endif
 
 
 static int test_hic(void)
@@ -37,6 +80,450 @@ static int test_hic(void)
   return 0;
 }
 
+// batch size that leaves a partial chunk
+#define NBATCH (HIC_BATCH+3)
+
+static int test_hic_xN(void)
+{
+  uint8_t sid[NBATCH][CRYPTO_BYTES];
+  uint8_t pw[NBATCH][CRYPTO_BYTES];
+  uint8_t sk_a[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk_a[NBATCH][CRYPTO_PUBLICKEYBYTES];
+  uint8_t pk_b[NBATCH][CRYPTO_PUBLICKEYBYTES];
+  uint8_t icc[NBATCH][CRYPTO_PUBLICKEYBYTES];
+  uint8_t icc1[CRYPTO_PUBLICKEYBYTES];
+  unsigned int i;
+
+  for(i=0;i<NBATCH;i++) {
+    randombytes(pw[i],CRYPTO_BYTES);
+    randombytes(sid[i],CRYPTO_BYTES);
+    crypto_kem_keypair(pk_a[i], sk_a);
+  }
+
+  hic_eval_xN(icc, (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])pk_a,
+              (const uint8_t (*)[CRYPTO_BYTES])pw,
+              (const uint8_t (*)[CRYPTO_BYTES])sid, NBATCH);
+  hic_inv_xN(pk_b, (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])icc,
+             (const uint8_t (*)[CRYPTO_BYTES])pw,
+             (const uint8_t (*)[CRYPTO_BYTES])sid, NBATCH);
+
+  for(i=0;i<NBATCH;i++) {
+    hic_eval(icc1, pk_a[i], pw[i], sid[i]);
+    if(memcmp(icc1, icc[i], CRYPTO_PUBLICKEYBYTES) ||
+       memcmp(pk_a[i], pk_b[i], CRYPTO_PUBLICKEYBYTES)) {
+      printf("ERROR hic_xN\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+// buffer sizes around the ones gen_x4 and gen_vector_aes256ctr use
+#define REJ_BUFLEN 600
+
+static int test_rejavx2(void)
+{
+  static const unsigned int lens[] = {1, 15, 16, 17, 31, 100, KYBER_N};
+  uint8_t buf[REJ_BUFLEN];
+  int16_t a[KYBER_N], b[KYBER_N];
+  unsigned int i, j, k, buflen, ctra, ctrb;
+
+  for(i=0;i<2;i++) {
+    randombytes(buf,REJ_BUFLEN);
+    // second round: mostly rejected candidates
+    if(i)
+      for(k=0;k<REJ_BUFLEN;k++)
+        buf[k] |= (k % 3 == 0) ? 0 : 0xD0;
+    for(j=0;j<sizeof(lens)/sizeof(lens[0]);j++) {
+      for(buflen=0;buflen<=REJ_BUFLEN;buflen+=(buflen < 64) ? 1 : 29) {
+        ctra = rej_uniform(a,lens[j],buf,buflen);
+        ctrb = rej_uniform_fast(b,lens[j],buf,buflen);
+        if(ctra != ctrb || memcmp(a, b, ctra*sizeof(int16_t))) {
+          printf("ERROR rej_uniform_fast\n");
+          return 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+static int test_keccak(void)
+{
+  static const size_t lens[] = {0, 1, 71, 72, 73, 135, 136, 137,
+                                2*KYBER_SYMBYTES, 3*KYBER_SYMBYTES,
+                                KYBER_PUBLICKEYBYTES,
+                                2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES};
+  uint8_t in[2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES];
+  uint8_t h0[64], h1[64];
+  uint64_t s0[25], s1[25];
+  unsigned int i;
+
+  randombytes(in,sizeof(in));
+  for(i=0;i<sizeof(lens)/sizeof(lens[0]);i++) {
+    sha3_256(h0,in,lens[i]);
+    sha3_256_fast(h1,in,lens[i]);
+    if(memcmp(h0, h1, 32)) {
+      printf("ERROR sha3_256_fast\n");
+      return 1;
+    }
+    sha3_512(h0,in,lens[i]);
+    sha3_512_fast(h1,in,lens[i]);
+    if(memcmp(h0, h1, 64)) {
+      printf("ERROR sha3_512_fast\n");
+      return 1;
+    }
+  }
+
+  memcpy(s0,in,sizeof(s0));
+  memcpy(s1,in,sizeof(s1));
+  KeccakF1600_StatePermute_compl(s0);
+  KeccakF1600_StatePermute_fast(s1);
+  if(memcmp(s0, s1, sizeof(s0))) {
+    printf("ERROR KeccakF1600_StatePermute_compl\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#ifdef PAKE_TURBOSHAKE
+static int test_turboshake(void)
+{
+  // RFC 9861 test vectors, ptn(n) = 00 01 .. FA 00 01 .. of n bytes
+  static const uint8_t ts128_empty[32] = {
+    0x1e, 0x41, 0x5f, 0x1c, 0x59, 0x83, 0xaf, 0xf2,
+    0x16, 0x92, 0x17, 0x27, 0x7d, 0x17, 0xbb, 0x53,
+    0x8c, 0xd9, 0x45, 0xa3, 0x97, 0xdd, 0xec, 0x54,
+    0x1f, 0x1c, 0xe4, 0x1a, 0xf2, 0xc1, 0xb7, 0x4c
+  };
+  static const uint8_t ts128_ptn289[32] = {
+    0x96, 0xc7, 0x7c, 0x27, 0x9e, 0x01, 0x26, 0xf7,
+    0xfc, 0x07, 0xc9, 0xb0, 0x7f, 0x5c, 0xda, 0xe1,
+    0xe0, 0xbe, 0x60, 0xbd, 0xbe, 0x10, 0x62, 0x00,
+    0x40, 0xe7, 0x5d, 0x72, 0x23, 0xa6, 0x24, 0xd2
+  };
+  static const uint8_t ts256_ptn17[64] = {
+    0xb3, 0xba, 0xb0, 0x30, 0x0e, 0x6a, 0x19, 0x1f,
+    0xbe, 0x61, 0x37, 0x93, 0x98, 0x35, 0x92, 0x35,
+    0x78, 0x79, 0x4e, 0xa5, 0x48, 0x43, 0xf5, 0x01,
+    0x10, 0x90, 0xfa, 0x2f, 0x37, 0x80, 0xa9, 0xe5,
+    0xcb, 0x22, 0xc5, 0x9d, 0x78, 0xb4, 0x0a, 0x0f,
+    0xbf, 0xf9, 0xe6, 0x72, 0xc0, 0xfb, 0xe0, 0x97,
+    0x0b, 0xd2, 0xc8, 0x45, 0x09, 0x1c, 0x60, 0x44,
+    0xd6, 0x87, 0x05, 0x4d, 0xa5, 0xd8, 0xe9, 0xc7
+  };
+  static const uint8_t ts256_ptn289[64] = {
+    0x66, 0xb8, 0x10, 0xdb, 0x8e, 0x90, 0x78, 0x04,
+    0x24, 0xc0, 0x84, 0x73, 0x72, 0xfd, 0xc9, 0x57,
+    0x10, 0x88, 0x2f, 0xde, 0x31, 0xc6, 0xdf, 0x75,
+    0xbe, 0xb9, 0xd4, 0xcd, 0x93, 0x05, 0xcf, 0xca,
+    0xe3, 0x5e, 0x7b, 0x83, 0xe8, 0xb7, 0xe6, 0xeb,
+    0x4b, 0x78, 0x60, 0x58, 0x80, 0x11, 0x63, 0x16,
+    0xfe, 0x2c, 0x07, 0x8a, 0x09, 0xb9, 0x4a, 0xd7,
+    0xb8, 0x21, 0x3c, 0x0a, 0x73, 0x8b, 0x65, 0xc0
+  };
+  // SHA3-256 of the gen_vector_turboshake coefficients (16-bit little
+  // endian) for seed = 00 01 .. 1F
+  static const uint8_t genvec[32] = {
+#if KYBER_K == 2
+    0x5f, 0xda, 0x82, 0x54, 0x41, 0x78, 0xe4, 0x58,
+    0xc3, 0x3e, 0xd8, 0x2e, 0x6f, 0x46, 0x64, 0xcc,
+    0xf2, 0x5c, 0xa6, 0x18, 0xce, 0x42, 0xcd, 0x1b,
+    0x75, 0xb1, 0x51, 0x10, 0xde, 0xd4, 0x7f, 0x59
+#elif KYBER_K == 3
+    0xa2, 0x31, 0xba, 0x0a, 0xad, 0x00, 0xaa, 0x60,
+    0xf9, 0xa3, 0xfd, 0x64, 0x31, 0x35, 0x13, 0x67,
+    0x4b, 0xab, 0x55, 0xe2, 0x83, 0xaf, 0x98, 0xcf,
+    0xb4, 0x4e, 0x93, 0xac, 0xf8, 0x23, 0x91, 0xc3
+#else
+    0x68, 0x87, 0x4d, 0x73, 0x04, 0x0a, 0x19, 0x75,
+    0x2a, 0xa0, 0x0a, 0xe6, 0xc7, 0x04, 0x8b, 0x38,
+    0xdb, 0x85, 0xc9, 0xdc, 0xee, 0x82, 0x98, 0x0d,
+    0xa9, 0xd9, 0x1b, 0x09, 0xab, 0x91, 0xe8, 0x7d
+#endif
+  };
+  uint8_t in[289], h[64], buf[2*KYBER_K*KYBER_N];
+  uint8_t seed[KYBER_SYMBYTES];
+  polyvec a;
+  poly r;
+  keccak_state state;
+  unsigned int i, j;
+
+  for(i=0;i<sizeof(in);i++)
+    in[i] = i % 0xFB;
+  turboshake128(h,32,in,0,0x1F);
+  if(memcmp(h, ts128_empty, 32)) {
+    printf("ERROR turboshake128\n");
+    return 1;
+  }
+  turboshake128(h,32,in,289,0x1F);
+  if(memcmp(h, ts128_ptn289, 32)) {
+    printf("ERROR turboshake128\n");
+    return 1;
+  }
+  // in pieces within one block
+  turboshake256_init(&state);
+  turboshake256_absorb(&state,in,5);
+  turboshake256_absorb(&state,in+5,12);
+  turboshake256_final(h,64,&state,0x1F);
+  if(memcmp(h, ts256_ptn17, 64)) {
+    printf("ERROR turboshake256\n");
+    return 1;
+  }
+  // in pieces of 100, 100 and 89 bytes, the middle and last ones
+  // straddling the 136-byte block boundaries at 136 and 272
+  turboshake256_init(&state);
+  turboshake256_absorb(&state,in,100);
+  turboshake256_absorb(&state,in+100,100);
+  turboshake256_absorb(&state,in+200,89);
+  turboshake256_final(h,64,&state,0x1F);
+  if(memcmp(h, ts256_ptn289, 64)) {
+    printf("ERROR turboshake256 blocks\n");
+    return 1;
+  }
+
+  for(i=0;i<KYBER_SYMBYTES;i++)
+    seed[i] = i;
+  gen_vector_turboshake(&a,seed);
+  for(i=0;i<KYBER_K;i++) {
+    gen_vector_poly_turboshake(&r,seed,i);
+    if(memcmp(&r, &a.vec[i], sizeof(poly))) {
+      printf("ERROR gen_vector_poly_turboshake\n");
+      return 1;
+    }
+    for(j=0;j<KYBER_N;j++) {
+      buf[2*(i*KYBER_N+j)+0] = a.vec[i].coeffs[j];
+      buf[2*(i*KYBER_N+j)+1] = a.vec[i].coeffs[j] >> 8;
+    }
+  }
+  sha3_256(h,buf,sizeof(buf));
+  if(memcmp(h, genvec, 32)) {
+    printf("ERROR gen_vector_turboshake\n");
+    return 1;
+  }
+
+  return 0;
+}
+#endif
+
+static int test_polymask(void)
+{
+  uint8_t seed[KYBER_SYMBYTES];
+  uint8_t a[KYBER_POLYVECBYTES];
+  uint8_t r0[KYBER_POLYVECBYTES], r1[KYBER_POLYVECBYTES];
+  polyvec m, t, u, v;
+  unsigned int i, j;
+
+  // any 12-bit input, also coefficients >= q
+  randombytes(a,KYBER_POLYVECBYTES);
+  randombytes(seed,KYBER_SYMBYTES);
+  gen_vector(&m,seed);
+
+  polyvec_frombytes(&t,a);
+  polyvec_add(&u,&t,&m);
+  polyvec_reduce(&u);
+  polyvec_tobytes(r0,&u);
+  polyvec_mask_add(r1,a,&m);
+  if(memcmp(r0, r1, KYBER_POLYVECBYTES)) {
+    printf("ERROR polyvec_mask_add\n");
+    return 1;
+  }
+
+  polyvec_sub(&u,&t,&m);
+  polyvec_reduce(&u);
+  polyvec_tobytes(r0,&u);
+  polyvec_mask_sub(r1,&v,a,&m);
+  if(memcmp(r0, r1, KYBER_POLYVECBYTES)) {
+    printf("ERROR polyvec_mask_sub\n");
+    return 1;
+  }
+  for(i=0;i<KYBER_K;i++)
+    for(j=0;j<KYBER_N;j++)
+      if(v.vec[i].coeffs[j] < 0 || v.vec[i].coeffs[j] >= KYBER_Q ||
+         (v.vec[i].coeffs[j] - u.vec[i].coeffs[j]) % KYBER_Q) {
+        printf("ERROR polyvec_mask_sub unpacked\n");
+        return 1;
+      }
+
+  return 0;
+}
+
+static int test_genx4(void)
+{
+  uint8_t seed[KYBER_SYMBYTES];
+  polyvec a[KYBER_K], b[KYBER_K];
+  int transposed;
+
+  randombytes(seed,KYBER_SYMBYTES);
+
+  gen_vector(&a[0],seed);
+  gen_vector_x4(&b[0],seed);
+  if(memcmp(&a[0], &b[0], sizeof(polyvec))) {
+    printf("ERROR gen_vector_x4\n");
+    return 1;
+  }
+
+  for(transposed=0;transposed<2;transposed++) {
+    gen_matrix(a,seed,transposed);
+    gen_matrix_x4(b,seed,transposed);
+    if(memcmp(a, b, sizeof(a))) {
+      printf("ERROR gen_matrix_x4\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+#ifdef GENAES_VECTOR
+static int test_genaes(void)
+{
+  // NIST SP 800-38A F.5.5 CTR-AES256.Encrypt, counter f0 f1 .. ff
+  static const uint8_t sp_key[32] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+    0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+    0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+  };
+  static const uint8_t sp_pt[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+  };
+  static const uint8_t sp_ct[64] = {
+    0x60, 0x1e, 0xc3, 0x13, 0x77, 0x57, 0x89, 0xa5,
+    0xb7, 0xa7, 0xf5, 0x04, 0xbb, 0xf3, 0xd2, 0x28,
+    0xf4, 0x43, 0xe3, 0xca, 0x4d, 0x62, 0xb5, 0x9a,
+    0xca, 0x84, 0xe9, 0x90, 0xca, 0xca, 0xf5, 0xc5,
+    0x2b, 0x09, 0x30, 0xda, 0xa2, 0x3d, 0xe9, 0x4c,
+    0xe8, 0x70, 0x17, 0xba, 0x2d, 0x84, 0x98, 0x8d,
+    0xdf, 0xc9, 0xc5, 0x8d, 0xb6, 0x7a, 0xad, 0xa6,
+    0x13, 0xc2, 0xdd, 0x08, 0x45, 0x79, 0x41, 0xa6
+  };
+  // SHA3-256 of the gen_vector_aes256ctr coefficients (16-bit little
+  // endian) for seed = 00 01 .. 1F, from openssl enc -aes-256-ctr with
+  // iv = i||FF||0^14 and the Kyber rejection sampling: pins the _tmp2
+  // mask layout independently of evp_ref.h
+  static const uint8_t genvec[32] = {
+#if KYBER_K == 2
+    0x48, 0x38, 0x35, 0x29, 0x9b, 0x55, 0x58, 0x43,
+    0xf3, 0x32, 0x88, 0xf3, 0x41, 0x71, 0x40, 0xe4,
+    0x85, 0xd1, 0x0a, 0x49, 0xed, 0xfc, 0x60, 0x1a,
+    0x54, 0x6d, 0x66, 0x11, 0xc7, 0x16, 0xaf, 0x3c
+#elif KYBER_K == 3
+    0x63, 0x37, 0xc1, 0x92, 0xa7, 0x95, 0xe6, 0x71,
+    0xeb, 0xc9, 0xf9, 0x64, 0x90, 0xed, 0xc6, 0x1d,
+    0xa8, 0xc2, 0xee, 0x66, 0x82, 0x5a, 0xbe, 0x54,
+    0xe1, 0xfc, 0x0b, 0x22, 0x76, 0x8f, 0x25, 0xe4
+#else
+    0x15, 0x7f, 0xf2, 0xe8, 0x6e, 0xb4, 0x47, 0xf2,
+    0x95, 0xa6, 0x69, 0xa7, 0x6c, 0x5b, 0x1f, 0x9b,
+    0x37, 0xef, 0x89, 0x1c, 0xa8, 0x0d, 0xed, 0x2f,
+    0x5a, 0x12, 0x60, 0x2c, 0x31, 0x4f, 0xf6, 0x89
+#endif
+  };
+  uint8_t seed[KYBER_SYMBYTES];
+  uint8_t nonce[12], ks[AES256CTR_BLOCKBYTES], h[32], buf[2*KYBER_K*KYBER_N];
+  aes256ctr_ctx state;
+  polyvec a, b;
+  unsigned int i, j;
+
+  for(i=0;i<12;i++)
+    nonce[i] = 0xf0 + i;
+  aes256ctr_init(&state,sp_key,nonce);
+  state.ctr = 0xfcfdfeff;
+  aes256ctr_squeezeblocks(ks,1,&state);
+  for(i=0;i<AES256CTR_BLOCKBYTES;i++) {
+    if((ks[i] ^ sp_pt[i]) != sp_ct[i]) {
+      printf("ERROR aes256ctr_squeezeblocks\n");
+      return 1;
+    }
+  }
+
+  for(i=0;i<KYBER_SYMBYTES;i++)
+    seed[i] = i;
+  gen_vector_aes256ctr(&a,seed);
+  for(i=0;i<KYBER_K;i++) {
+    for(j=0;j<KYBER_N;j++) {
+      buf[2*(i*KYBER_N+j)+0] = a.vec[i].coeffs[j];
+      buf[2*(i*KYBER_N+j)+1] = a.vec[i].coeffs[j] >> 8;
+    }
+  }
+  sha3_256(h,buf,sizeof(buf));
+  if(memcmp(h, genvec, 32)) {
+    printf("ERROR gen_vector_aes256ctr layout\n");
+    return 1;
+  }
+
+  /*
+    The submodule gen_vector with TEMPO_VECTOR_ALG=2, where the fork
+    implements it: a stub that ignores the algorithm returns the
+    SHAKE-128 layout of gen_vector_x4, and is not compared.
+  */
+  gen_vector(&a,seed);
+  gen_vector_x4(&b,seed);
+  if(memcmp(&a, &b, sizeof(polyvec))) {
+    gen_vector_aes256ctr(&b,seed);
+    if(memcmp(&a, &b, sizeof(polyvec))) {
+      printf("ERROR gen_vector_aes256ctr submodule\n");
+      return 1;
+    }
+  }
+
+  randombytes(seed,KYBER_SYMBYTES);
+
+  gen_vector_evp(&a,seed);
+  gen_vector_aes256ctr(&b,seed);
+  if(memcmp(&a, &b, sizeof(polyvec))) {
+    printf("ERROR gen_vector_aes256ctr\n");
+    return 1;
+  }
+
+  for(i=0;i<KYBER_K;i++) {
+    gen_vector_poly_aes256ctr(&b.vec[0],seed,i);
+    if(memcmp(&a.vec[i], &b.vec[0], sizeof(poly))) {
+      printf("ERROR gen_vector_poly_aes256ctr\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+#endif
+static int test_kem_unpacked(void)
+{
+  uint8_t coins[CRYPTO_BYTES];
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t ct_a[CRYPTO_CIPHERTEXTBYTES];
+  uint8_t ct_b[CRYPTO_CIPHERTEXTBYTES];
+  uint8_t ss_a[CRYPTO_BYTES];
+  uint8_t ss_b[CRYPTO_BYTES];
+  polyvec pkpv;
+
+  randombytes(coins,CRYPTO_BYTES);
+  crypto_kem_keypair(pk,sk);
+  polyvec_frombytes(&pkpv,pk);
+
+  crypto_kem_enc_derand(ct_a,ss_a,pk,coins);
+  kem_enc_unpacked_derand(ct_b,ss_b,pk,&pkpv,coins);
+  if(memcmp(ct_a, ct_b, CRYPTO_CIPHERTEXTBYTES) || memcmp(ss_a, ss_b, CRYPTO_BYTES)) {
+    printf("ERROR kem unpacked\n");
+    return 1;
+  }
+
+  return 0;
+}
+
 static int test_pake(void)
 {
   uint8_t sid[CRYPTO_BYTES];
@@ -61,18 +548,337 @@ static int test_pake(void)
 
   return 0;
 }
+
+#define NPAKEBATCH (PAKE_BATCH+3)
+
+static int test_pake_batch(void)
+{
+  uint8_t sid[NPAKEBATCH][CRYPTO_BYTES];
+  uint8_t pw[NPAKEBATCH][CRYPTO_BYTES];
+  uint8_t sk[NPAKEBATCH][CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[NPAKEBATCH][CRYPTO_PUBLICKEYBYTES];
+  uint8_t key_a[NPAKEBATCH][CRYPTO_BYTES];
+  uint8_t key_b[NPAKEBATCH][CRYPTO_BYTES];
+  uint8_t key_c[CRYPTO_BYTES];
+  uint8_t msg1[NPAKEBATCH][MSG1_LEN];
+  uint8_t msg2[NPAKEBATCH][MSG2_LEN];
+  int result[NPAKEBATCH];
+  unsigned int i;
+
+  for(i=0;i<NPAKEBATCH;i++) {
+    randombytes(pw[i],CRYPTO_BYTES);
+    randombytes(sid[i],CRYPTO_BYTES);
+    initStart(msg1[i],pk[i],sk[i],pw[i],sid[i]);
+  }
+
+  resp_batch(key_b,msg2,(const uint8_t (*)[MSG1_LEN])msg1,
+             (const uint8_t (*)[CRYPTO_BYTES])pw,
+             (const uint8_t (*)[CRYPTO_BYTES])sid,NPAKEBATCH);
+  if(initEnd_batch(key_a,result,(const uint8_t (*)[MSG2_LEN])msg2,
+                   (const uint8_t (*)[MSG1_LEN])msg1,
+                   (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])pk,
+                   (const uint8_t (*)[CRYPTO_SECRETKEYBYTES])sk,
+                   (const uint8_t (*)[CRYPTO_BYTES])sid,NPAKEBATCH)) {
+    printf("ERROR pake batch\n");
+    return 1;
+  }
+
+  for(i=0;i<NPAKEBATCH;i++) {
+    if(initEnd(key_c,msg2[i],msg1[i],pk[i],sk[i],sid[i]) ||
+       memcmp(key_c, key_a[i], CRYPTO_BYTES) ||
+       memcmp(key_a[i], key_b[i], CRYPTO_BYTES)) {
+      printf("ERROR pake batch\n");
+      return 1;
+    }
+  }
+
+  // a bad tag only fails its own session
+  msg2[NPAKEBATCH-1][0] ^= 1;
+  if(!initEnd_batch(key_a,result,(const uint8_t (*)[MSG2_LEN])msg2,
+                    (const uint8_t (*)[MSG1_LEN])msg1,
+                    (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])pk,
+                    (const uint8_t (*)[CRYPTO_SECRETKEYBYTES])sk,
+                    (const uint8_t (*)[CRYPTO_BYTES])sid,NPAKEBATCH)) {
+    printf("ERROR pake batch tag\n");
+    return 1;
+  }
+  for(i=0;i<NPAKEBATCH;i++) {
+    if((result[i] != 0) != (i == NPAKEBATCH-1)) {
+      printf("ERROR pake batch tag\n");
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+static int test_pake_prefix(void)
+{
+  uint8_t sid[CRYPTO_BYTES];
+  uint8_t pw[CRYPTO_BYTES];
+  pake_init_state st;
+  uint8_t key_a[CRYPTO_BYTES];
+  uint8_t key_b[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+
+  randombytes(pw,CRYPTO_BYTES);
+  randombytes(sid,CRYPTO_BYTES);
+
+  initStartPrefix(msg1,&st,pw,sid);
+  resp(key_a,msg2,msg1,pw,sid);
+  if(initEndPrefix(key_b,msg2,&st) || memcmp(key_a, key_b, CRYPTO_BYTES)) {
+    printf("ERROR pake prefix\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
+#ifdef PAKE_RANDBUF
+// the seeded mode replays its stream, across refills; OS mode does not
+static int test_randbuf(void)
+{
+  static const uint8_t seed_a[KYBER_SYMBYTES] = {1}, seed_b[KYBER_SYMBYTES] = {2};
+  uint8_t sid[CRYPTO_BYTES] = {0};
+  uint8_t pw[CRYPTO_BYTES] = {0};
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t msg1_a[MSG1_LEN], msg1_b[MSG1_LEN];
+  static uint8_t buf_a[10000], buf_b[10000];
+  uint8_t in[KYBER_SYMBYTES+8] = {1};
+
+  // the first refill is SHAKE256(seed || 0), after the next key
+  shake256(buf_a,2*KYBER_SYMBYTES,in,sizeof(in));
+  randbuf_seed(seed_a);
+  randombytes(buf_b,KYBER_SYMBYTES);
+  if(memcmp(buf_a+KYBER_SYMBYTES,buf_b,KYBER_SYMBYTES)) {
+    printf("ERROR randbuf shake256\n");
+    return 1;
+  }
+
+  randbuf_seed(seed_a);
+  initStart(msg1_a,pk,sk,pw,sid);
+  randombytes(buf_a,sizeof(buf_a));
+  randbuf_seed(seed_a);
+  initStart(msg1_b,pk,sk,pw,sid);
+  randombytes(buf_b,sizeof(buf_b));
+  if(memcmp(msg1_a,msg1_b,MSG1_LEN) || memcmp(buf_a,buf_b,sizeof(buf_a))) {
+    printf("ERROR randbuf seeded\n");
+    return 1;
+  }
+
+  randbuf_seed(seed_b);
+  initStart(msg1_b,pk,sk,pw,sid);
+  if(!memcmp(msg1_a,msg1_b,MSG1_LEN)) {
+    printf("ERROR randbuf seeds\n");
+    return 1;
+  }
+
+  randbuf_seed(NULL);
+  randombytes(buf_a,KYBER_SYMBYTES);
+  randbuf_seed(NULL);
+  randombytes(buf_b,KYBER_SYMBYTES);
+  if(!memcmp(buf_a,buf_b,KYBER_SYMBYTES)) {
+    printf("ERROR randbuf reseed\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
+#ifdef PAKE_KEYPOOL
+static int test_pake_pool(keypool *pool)
+{
+  uint8_t sid[CRYPTO_BYTES];
+  uint8_t pw[CRYPTO_BYTES];
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t key_a[CRYPTO_BYTES];
+  uint8_t key_b[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+
+  randombytes(pw,CRYPTO_BYTES);
+  randombytes(sid,CRYPTO_BYTES);
+
+  initStartPool(msg1,pk,sk,pw,sid,pool);
+  resp(key_a,msg2,msg1,pw,sid);
+  if(initEnd(key_b,msg2,msg1,pk,sk,sid) || memcmp(key_a, key_b, CRYPTO_BYTES)) {
+    printf("ERROR pake pool\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
+#ifdef PAKE_COMPACT_STATE
+static int test_pake_compact(void)
+{
+  uint8_t sid[CRYPTO_BYTES];
+  uint8_t pw[CRYPTO_BYTES];
+  pake_compact_state st;
+  uint8_t key_a[CRYPTO_BYTES];
+  uint8_t key_b[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+
+  randombytes(pw,CRYPTO_BYTES);
+  randombytes(sid,CRYPTO_BYTES);
+
+  initStartCompact(msg1,&st,pw,sid);
+  resp(key_a,msg2,msg1,pw,sid);
+  if(initEndCompact(key_b,msg2,&st,sid) || memcmp(key_a, key_b, CRYPTO_BYTES)) {
+    printf("ERROR pake compact\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
+#ifdef PAKE_FAT_STATE
+static int test_kem_fat(void)
+{
+  uint8_t coins[2*CRYPTO_BYTES];
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk_a[CRYPTO_PUBLICKEYBYTES];
+  uint8_t pk_b[CRYPTO_PUBLICKEYBYTES];
+  uint8_t ct[CRYPTO_CIPHERTEXTBYTES];
+  uint8_t ss_a[CRYPTO_BYTES];
+  uint8_t ss_b[CRYPTO_BYTES];
+  kem_fat_sk fsk;
+
+  randombytes(coins,2*CRYPTO_BYTES);
+  crypto_kem_keypair_derand(pk_a,sk,coins);
+  kem_fat_keypair_derand(pk_b,&fsk,coins);
+  if(memcmp(pk_a, pk_b, CRYPTO_PUBLICKEYBYTES)) {
+    printf("ERROR kem fat keypair\n");
+    return 1;
+  }
+
+  // a valid ciphertext, then a corrupted one (implicit rejection)
+  crypto_kem_enc(ct,ss_a,pk_a);
+  kem_fat_dec(ss_b,ct,&fsk);
+  if(memcmp(ss_a, ss_b, CRYPTO_BYTES)) {
+    printf("ERROR kem fat dec\n");
+    return 1;
+  }
+  ct[coins[0] % CRYPTO_CIPHERTEXTBYTES] ^= 1 << (coins[1] & 7);
+  crypto_kem_dec(ss_a,ct,sk);
+  kem_fat_dec(ss_b,ct,&fsk);
+  if(memcmp(ss_a, ss_b, CRYPTO_BYTES)) {
+    printf("ERROR kem fat dec reject\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+static int test_pake_fat(void)
+{
+  uint8_t sid[CRYPTO_BYTES];
+  uint8_t pw[CRYPTO_BYTES];
+  kem_fat_sk sk;
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t key_a[CRYPTO_BYTES];
+  uint8_t key_b[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+
+  randombytes(pw,CRYPTO_BYTES);
+  randombytes(sid,CRYPTO_BYTES);
+
+  initStartFat(msg1,pk,&sk,pw,sid);
+  resp(key_a,msg2,msg1,pw,sid);
+  if(initEndFat(key_b,msg2,msg1,pk,&sk,sid) || memcmp(key_a, key_b, CRYPTO_BYTES)) {
+    printf("ERROR pake fat\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
 int main(void)
 {
   unsigned int i;
   int r;
 
+  for(i=0;i<NTESTS/NBATCH;i++) {
+    if(test_hic_xN())
+      return 1;
+  }
+
+  for(i=0;i<NTESTS/NPAKEBATCH;i++) {
+    if(test_pake_batch())
+      return 1;
+  }
+
+#ifdef PAKE_KEYPOOL
+  {
+    keypool *pool = keypool_new(64);
+    uint64_t hits, misses;
+
+    if(pool == NULL)
+      return 1;
+    for(i=0;i<NTESTS;i++) {
+      if(test_pake_pool(pool))
+        return 1;
+    }
+    keypool_stats(pool,&hits,&misses);
+    keypool_free(pool);
+    printf("keypool hits: %llu misses: %llu\n",
+           (unsigned long long)hits, (unsigned long long)misses);
+    if(hits+misses != NTESTS)
+      return 1;
+  }
+#endif
+
   for(i=0;i<NTESTS;i++) {
     r  = test_hic();
+    r  |= test_genx4();
+    r  |= test_rejavx2();
+    r  |= test_keccak();
+#ifdef PAKE_TURBOSHAKE
+    r  |= test_turboshake();
+#endif
+    r  |= test_polymask();
+#ifdef GENAES_VECTOR
+    r  |= test_genaes();
+#endif
+    r  |= test_kem_unpacked();
     r  |= test_pake();
+#ifdef PAKE_TRANSCRIPT_PREFIX
+    r  |= test_pake_prefix();
+#endif
+#ifdef PAKE_COMPACT_STATE
+    r  |= test_pake_compact();
+#endif
+#ifdef PAKE_FAT_STATE
+    r  |= test_kem_fat();
+    r  |= test_pake_fat();
+#endif
     if(r)
       return 1;
   }
 
+#ifdef PAKE_RANDBUF
+  {
+    uint64_t calls, syscalls;
+
+    if(test_randbuf())
+      return 1;
+    randbuf_stats(&calls,&syscalls);
+    printf("randbuf calls: %llu syscalls: %llu\n",
+           (unsigned long long)calls, (unsigned long long)syscalls);
+  }
+#endif
+
   printf("CRYPTO_SECRETKEYBYTES:  %d\n",CRYPTO_SECRETKEYBYTES);
   printf("CRYPTO_PUBLICKEYBYTES:  %d\n",CRYPTO_PUBLICKEYBYTES);
   printf("CRYPTO_CIPHERTEXTBYTES: %d\n",CRYPTO_CIPHERTEXTBYTES);
@@ -0,0 +1,477 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "../rijndael256/rijndael.h"
+#include "../rijndael256/rijndael_ni.h"
+#include "../rijndael256/rijndael_bs.h"
+#include "test/cpucycles.h"
+
+/*
+  Conformance and throughput gate for the Rijndael-256/256 backends
+  behind ic256: every vector of the NESSIE file is checked against
+  every backend available on this CPU, then key-schedule, encrypt and
+  decrypt cycles are reported per backend.
+*/
+
+#define VECTORS "rijndael256/rijndael-256-256.unverified.test-vectors.txt"
+#define NTESTS 10000
+#define LANES XRIJNDAEL_BS_LANES
+
+/*************************************************
+ * NESSIE vector file
+ * **********************************************/
+
+enum { F_KEY, F_PLAIN, F_CIPHER, F_DECRYPTED, F_ENCRYPTED,
+       F_ITER100, F_ITER1000, NFIELDS };
+
+static const char *field_names[NFIELDS] = {
+  "key", "plain", "cipher", "decrypted", "encrypted",
+  "Iterated 100 times", "Iterated 1000 times"
+};
+
+typedef struct {
+  int set, num;
+  unsigned int have;
+  xword32 v[NFIELDS][8];
+} vector;
+
+static int hex_append(xword8 *out, size_t *len, const char *s)
+{
+  unsigned int x;
+
+  while(isxdigit((unsigned char)s[0]) && isxdigit((unsigned char)s[1])) {
+    if(*len == 32 || sscanf(s, "%2x", &x) != 1)
+      return -1;
+    out[(*len)++] = (xword8)x;
+    s += 2;
+  }
+  return 0;
+}
+
+static vector *read_vectors(const char *path, size_t *n)
+{
+  FILE *f = fopen(path, "r");
+  char line[256], name[64];
+  vector *vs = NULL, *cur = NULL;
+  size_t cap = 0, len = 0;
+  int field = -1, set, num, i;
+  char *eq, *p;
+
+  *n = 0;
+  if(f == NULL)
+    return NULL;
+
+  while(fgets(line, sizeof(line), f)) {
+    if(sscanf(line, "Set %d, vector# %d:", &set, &num) == 2) {
+      if(*n == cap) {
+        cap = cap ? 2*cap : 256;
+        vs = realloc(vs, cap*sizeof(vector));
+        if(vs == NULL)
+          break;
+      }
+      cur = &vs[(*n)++];
+      memset(cur, 0, sizeof(vector));
+      cur->set = set;
+      cur->num = num;
+      field = -1;
+      continue;
+    }
+    if(cur == NULL)
+      continue;
+
+    p = line;
+    if((eq = strchr(line, '=')) != NULL) {
+      // "   label=HEX" starts a field, the next line continues it
+      for(p = line; isspace((unsigned char)*p); p++);
+      snprintf(name, sizeof(name), "%.*s", (int)(eq - p), p);
+      field = -1;
+      for(i = 0; i < NFIELDS; i++)
+        if(!strcmp(name, field_names[i]))
+          field = i;
+      len = 0;
+      p = eq + 1;
+    } else {
+      for(; isspace((unsigned char)*p); p++);
+    }
+    if(field < 0 || !isxdigit((unsigned char)*p))
+      continue;
+    if(hex_append((xword8 *)cur->v[field], &len, p)) {
+      fprintf(stderr, "bad hex in set %d vector %d\n", cur->set, cur->num);
+      exit(1);
+    }
+    if(len == 32)
+      cur->have |= 1u << field;
+  }
+  fclose(f);
+  return vs;
+}
+
+/*************************************************
+ * Backends
+ * **********************************************/
+
+/*
+  keysched/deckeysched are NULL for one-shot backends, whose
+  encrypt/decrypt take the key directly. Bitsliced backends handle
+  LANES (key, block) pairs per call.
+*/
+typedef struct {
+  const char *name;
+  int (*available)(void);
+  int lanes;
+  void (*keysched)(const xword32 key[8], xword32 rk[MAXRK]);
+  void (*deckeysched)(xword32 dk[MAXRK], const xword32 rk[MAXRK]);
+  void (*encrypt)(xword32 *block, const xword32 *key, const xword32 *rk);
+  void (*decrypt)(xword32 *block, const xword32 *key, const xword32 *dk);
+} backend;
+
+static int always(void)
+{
+  return 1;
+}
+
+// ccrypt generic code, which keeps BC/KC/ROUNDS next to the round
+// keys: the schedule lives in ccrypt_rkk and rk is only a copy
+static roundkey ccrypt_rkk;
+
+static void ccrypt_ks(const xword32 key[8], xword32 rk[MAXRK])
+{
+  xword32 k[8];
+
+  memcpy(k, key, 32);
+  xrijndaelKeySched(k, 256, 256, &ccrypt_rkk);
+  memcpy(rk, ccrypt_rkk.rk, sizeof(ccrypt_rkk.rk));
+}
+
+static void ccrypt_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)key;
+  (void)rk;
+  xrijndaelEncrypt(block, &ccrypt_rkk);
+}
+
+static void ccrypt_dec(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)key;
+  (void)rk;
+  xrijndaelDecrypt(block, &ccrypt_rkk);
+}
+
+// 256/256 tables
+static void tables_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)key;
+  xrijndael256Encrypt(block, rk);
+}
+
+static void tables_dec(xword32 *block, const xword32 *key, const xword32 *dk)
+{
+  (void)key;
+  xrijndael256Decrypt(block, dk);
+}
+
+static void tables1_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)rk;
+  xrijndael256EncryptKey(block, key);
+}
+
+static void tables1_dec(xword32 *block, const xword32 *key, const xword32 *dk)
+{
+  (void)dk;
+  xrijndael256DecryptKey(block, key);
+}
+
+#ifdef RIJNDAEL_NI
+static void ni_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)key;
+  xrijndael256niEncrypt(block, rk);
+}
+
+static void ni_dec(xword32 *block, const xword32 *key, const xword32 *dk)
+{
+  (void)key;
+  xrijndael256niDecrypt(block, dk);
+}
+
+static void ni1_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)rk;
+  xrijndael256niEncryptKey(block, key);
+}
+
+static void ni1_dec(xword32 *block, const xword32 *key, const xword32 *dk)
+{
+  (void)dk;
+  xrijndael256niDecryptKey(block, key);
+}
+#endif
+
+#ifdef RIJNDAEL_BS
+static void bs_enc(xword32 *block, const xword32 *key, const xword32 *rk)
+{
+  (void)rk;
+  xrijndael256bsEncrypt((xword8 (*)[32])block, (const xword8 (*)[32])key);
+}
+
+static void bs_dec(xword32 *block, const xword32 *key, const xword32 *dk)
+{
+  (void)dk;
+  xrijndael256bsDecrypt((xword8 (*)[32])block, (const xword8 (*)[32])key);
+}
+#endif
+
+static const backend backends[] = {
+  { "ccrypt", always, 1, ccrypt_ks, NULL, ccrypt_enc, ccrypt_dec },
+  { "256/256 tables", always, 1, xrijndael256KeySched,
+    xrijndael256DecKeySched, tables_enc, tables_dec },
+  { "256/256 one-shot", always, 1, NULL, NULL, tables1_enc, tables1_dec },
+#ifdef RIJNDAEL_NI
+  { "aes-ni", xrijndael256niAvailable, 1, xrijndael256niKeySched,
+    xrijndael256niDecKeySched, ni_enc, ni_dec },
+  { "aes-ni one-shot", xrijndael256niAvailable, 1, NULL, NULL,
+    ni1_enc, ni1_dec },
+#endif
+#ifdef RIJNDAEL_BS
+  { "bitsliced", xrijndael256bsAvailable, LANES, NULL, NULL,
+    bs_enc, bs_dec },
+#endif
+};
+
+#define NBACKENDS (sizeof(backends)/sizeof(backends[0]))
+
+/*
+  Single-block encrypt/decrypt through a one-lane backend, the key
+  schedule included.
+*/
+static void one_block(const backend *b, xword32 block[8],
+                      const xword32 key[8], int dec)
+{
+  static xword32 rk[MAXRK];
+
+  if(b->keysched) {
+    b->keysched(key, rk);
+    if(dec && b->deckeysched)
+      b->deckeysched(rk, rk);
+  }
+  if(dec)
+    b->decrypt(block, key, rk);
+  else
+    b->encrypt(block, key, rk);
+}
+
+/*
+  The checks of a multi-lane backend, LANES different vectors per
+  call: the vectors with a key and both fields of a check go through
+  in groups, lane l holding the l-th vector of the group and compared
+  with its own expected value. Lanes past the end of the last group
+  repeat its first vector.
+*/
+static const struct {
+  int in, out, dec, iters;
+} lane_checks[] = {
+  { F_PLAIN, F_CIPHER, 0, 1 },
+  { F_CIPHER, F_PLAIN, 1, 1 },
+  { F_CIPHER, F_DECRYPTED, 1, 1 },
+  { F_PLAIN, F_ENCRYPTED, 0, 1 },
+  { F_PLAIN, F_ITER100, 0, 100 },
+  { F_PLAIN, F_ITER1000, 0, 1000 },
+};
+
+static int check_lanes(const backend *b, const vector *vs, size_t n)
+{
+  static xword32 blocks[LANES][8], keys[LANES][8];
+  const vector *group[LANES];
+  unsigned int need;
+  int fail = 0, c, l, k, iters;
+  size_t i;
+
+  for(c = 0; c < (int)(sizeof(lane_checks)/sizeof(lane_checks[0])); c++) {
+    need = 1u << F_KEY | 1u << lane_checks[c].in | 1u << lane_checks[c].out;
+    i = 0;
+    for(;;) {
+      for(k = 0; k < b->lanes && i < n; i++) {
+        if((vs[i].have & need) == need)
+          group[k++] = &vs[i];
+      }
+      if(k == 0)
+        break;
+      for(l = 0; l < b->lanes; l++) {
+        memcpy(keys[l], group[l < k ? l : 0]->v[F_KEY], 32);
+        memcpy(blocks[l], group[l < k ? l : 0]->v[lane_checks[c].in], 32);
+      }
+      for(iters = lane_checks[c].iters; iters > 0; iters--) {
+        if(lane_checks[c].dec)
+          b->decrypt(blocks[0], keys[0], NULL);
+        else
+          b->encrypt(blocks[0], keys[0], NULL);
+      }
+      for(l = 0; l < k; l++) {
+        if(memcmp(blocks[l], group[l]->v[lane_checks[c].out], 32)
+           && fail++ < 10)
+          printf("  %s: lane %d, set %d vector %d: %s mismatch\n",
+                 b->name, l, group[l]->set, group[l]->num,
+                 field_names[lane_checks[c].out]);
+      }
+    }
+  }
+  return fail;
+}
+
+static int check(const backend *b, const vector *vs, size_t n)
+{
+  xword32 x[8];
+  int fail = 0, j, iters;
+  size_t i;
+  const vector *v;
+
+  if(b->lanes > 1)
+    return check_lanes(b, vs, n);
+
+#define EXPECT(f) do {                                                   \
+    if(memcmp(x, v->v[f], 32)) {                                         \
+      if(fail++ < 10)                                                    \
+        printf("  %s: set %d vector %d: %s mismatch\n",                  \
+               b->name, v->set, v->num, field_names[f]);                 \
+    }                                                                    \
+  } while(0)
+#define HAS(f) (v->have & (1u << (f)))
+
+  for(i = 0; i < n; i++) {
+    v = &vs[i];
+    if(!HAS(F_KEY))
+      continue;
+    if(HAS(F_PLAIN) && HAS(F_CIPHER)) {
+      memcpy(x, v->v[F_PLAIN], 32);
+      one_block(b, x, v->v[F_KEY], 0);
+      EXPECT(F_CIPHER);
+      memcpy(x, v->v[F_CIPHER], 32);
+      one_block(b, x, v->v[F_KEY], 1);
+      EXPECT(F_PLAIN);
+    }
+    if(HAS(F_CIPHER) && HAS(F_DECRYPTED)) {
+      memcpy(x, v->v[F_CIPHER], 32);
+      one_block(b, x, v->v[F_KEY], 1);
+      EXPECT(F_DECRYPTED);
+    }
+    if(HAS(F_PLAIN) && HAS(F_ENCRYPTED)) {
+      memcpy(x, v->v[F_PLAIN], 32);
+      one_block(b, x, v->v[F_KEY], 0);
+      EXPECT(F_ENCRYPTED);
+    }
+    for(j = F_ITER100; j <= F_ITER1000; j++) {
+      if(!HAS(F_PLAIN) || !HAS(j))
+        continue;
+      iters = j == F_ITER100 ? 100 : 1000;
+      memcpy(x, v->v[F_PLAIN], 32);
+      while(iters--)
+        one_block(b, x, v->v[F_KEY], 0);
+      EXPECT(j);
+    }
+  }
+  return fail;
+}
+
+/*************************************************
+ * Throughput
+ * **********************************************/
+
+static uint64_t t[NTESTS];
+
+static int cmp_uint64(const void *a, const void *b)
+{
+  if(*(const uint64_t *)a < *(const uint64_t *)b) return -1;
+  if(*(const uint64_t *)a > *(const uint64_t *)b) return 1;
+  return 0;
+}
+
+// median cycles of one run, over NTESTS-1 runs
+static uint64_t median(void)
+{
+  int i;
+
+  for(i = 0; i < NTESTS - 1; i++)
+    t[i] = t[i+1] - t[i];
+  qsort(t, NTESTS - 1, sizeof(uint64_t), cmp_uint64);
+  return t[(NTESTS - 1)/2];
+}
+
+static void bench(const backend *b)
+{
+  static xword32 blocks[LANES][8], keys[LANES][8], rk[MAXRK], dk[MAXRK];
+  uint64_t ks = 0, enc, dec;
+  int i;
+
+  for(i = 0; i < LANES; i++)
+    keys[i][0] = i + 1;
+
+  if(b->keysched) {
+    for(i = 0; i < NTESTS; i++) {
+      t[i] = cpucycles();
+      b->keysched(keys[0], rk);
+    }
+    ks = median();
+    if(b->deckeysched)
+      b->deckeysched(dk, rk);
+    else
+      memcpy(dk, rk, sizeof(rk));
+  }
+
+  for(i = 0; i < NTESTS; i++) {
+    t[i] = cpucycles();
+    b->encrypt(blocks[0], keys[0], rk);
+  }
+  enc = median() / b->lanes;
+
+  for(i = 0; i < NTESTS; i++) {
+    t[i] = cpucycles();
+    b->decrypt(blocks[0], keys[0], dk);
+  }
+  dec = median() / b->lanes;
+
+  if(b->keysched)
+    printf("%-20s %12llu %14llu %14llu\n", b->name,
+           (unsigned long long)ks, (unsigned long long)enc,
+           (unsigned long long)dec);
+  else
+    printf("%-20s %12s %14llu %14llu   (key setup included)\n", b->name,
+           "-", (unsigned long long)enc, (unsigned long long)dec);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *path = argc > 1 ? argv[1] : VECTORS;
+  vector *vs;
+  size_t n, i;
+  int fail = 0, r;
+
+  vs = read_vectors(path, &n);
+  if(vs == NULL || n == 0) {
+    fprintf(stderr, "cannot read test vectors from %s\n", path);
+    return 1;
+  }
+  printf("%zu vectors from %s\n\n", n, path);
+
+  for(i = 0; i < NBACKENDS; i++) {
+    if(!backends[i].available()) {
+      printf("%-20s not available on this CPU\n", backends[i].name);
+      continue;
+    }
+    r = check(&backends[i], vs, n);
+    printf("%-20s %s\n", backends[i].name, r ? "FAIL" : "ok");
+    fail |= r;
+  }
+
+  printf("\n%-20s %12s %14s %14s\n", "backend", "keysched", "enc/block",
+         "dec/block");
+  for(i = 0; i < NBACKENDS; i++)
+    if(backends[i].available())
+      bench(&backends[i]);
+
+  free(vs);
+  return fail != 0;
+}
@@ -0,0 +1,176 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "keccakf1600.h"
+#include "turboshake.h"
+
+static uint64_t load64(const uint8_t x[8])
+{
+  unsigned int i;
+  uint64_t r = 0;
+
+  for(i=0;i<8;i++)
+    r |= (uint64_t)x[i] << 8*i;
+  return r;
+}
+
+static void store64(uint8_t x[8], uint64_t u)
+{
+  unsigned int i;
+
+  for(i=0;i<8;i++)
+    x[i] = u >> 8*i;
+}
+
+static void ts_init(keccak_state *state)
+{
+  memset(state->s, 0, sizeof(state->s));
+  state->pos = 0;
+}
+
+static void ts_absorb(keccak_state *state, unsigned int r,
+                      const uint8_t *in, size_t inlen)
+{
+  unsigned int pos = state->pos;
+  uint64_t *s = state->s;
+  unsigned int i;
+
+  while(inlen) {
+    // whole blocks straight from the input
+    if(pos == 0 && inlen >= r) {
+      for(i=0;i<r/8;i++)
+        s[i] ^= load64(in+8*i);
+      KeccakP1600_12_StatePermute_fast(s);
+      in += r;
+      inlen -= r;
+      continue;
+    }
+    s[pos/8] ^= (uint64_t)*in++ << 8*(pos%8);
+    pos++;
+    inlen--;
+    if(pos == r) {
+      KeccakP1600_12_StatePermute_fast(s);
+      pos = 0;
+    }
+  }
+  state->pos = pos;
+}
+
+static void ts_finalize(keccak_state *state, unsigned int r, uint8_t ds)
+{
+  unsigned int pos = state->pos;
+
+  state->s[pos/8] ^= (uint64_t)ds << 8*(pos%8);
+  state->s[r/8-1] ^= 1ULL << 63;
+  state->pos = r;
+}
+
+static void ts_squeeze(uint8_t *out, size_t outlen, keccak_state *state,
+                       unsigned int r)
+{
+  unsigned int pos = state->pos;
+  uint64_t *s = state->s;
+
+  while(outlen) {
+    if(pos == r) {
+      KeccakP1600_12_StatePermute_fast(s);
+      pos = 0;
+    }
+    for(;pos < r && outlen;pos++) {
+      *out++ = s[pos/8] >> 8*(pos%8);
+      outlen--;
+    }
+  }
+  state->pos = pos;
+}
+
+void turboshake128_init(keccak_state *state)
+{
+  ts_init(state);
+}
+
+void turboshake128_absorb(keccak_state *state, const uint8_t *in, size_t inlen)
+{
+  ts_absorb(state, TURBOSHAKE128_RATE, in, inlen);
+}
+
+void turboshake128_finalize(keccak_state *state, uint8_t ds)
+{
+  ts_finalize(state, TURBOSHAKE128_RATE, ds);
+}
+
+void turboshake128_squeeze(uint8_t *out, size_t outlen, keccak_state *state)
+{
+  ts_squeeze(out, outlen, state, TURBOSHAKE128_RATE);
+}
+
+/*************************************************
+* Name:        turboshake128_squeezeblocks
+*
+* Description: Squeezes full blocks; only right after finalize or
+*              a previous squeezeblocks
+*
+* Arguments:   - uint8_t *out: pointer to output blocks
+*              - size_t nblocks: number of blocks to be squeezed
+*              - keccak_state *state: pointer to input/output state
+**************************************************/
+void turboshake128_squeezeblocks(uint8_t *out, size_t nblocks, keccak_state *state)
+{
+  unsigned int i;
+
+  while(nblocks > 0) {
+    KeccakP1600_12_StatePermute_fast(state->s);
+    for(i=0;i<TURBOSHAKE128_RATE/8;i++)
+      store64(out+8*i, state->s[i]);
+    out += TURBOSHAKE128_RATE;
+    nblocks--;
+  }
+}
+
+void turboshake256_init(keccak_state *state)
+{
+  ts_init(state);
+}
+
+void turboshake256_absorb(keccak_state *state, const uint8_t *in, size_t inlen)
+{
+  ts_absorb(state, TURBOSHAKE256_RATE, in, inlen);
+}
+
+void turboshake256_finalize(keccak_state *state, uint8_t ds)
+{
+  ts_finalize(state, TURBOSHAKE256_RATE, ds);
+}
+
+void turboshake256_squeeze(uint8_t *out, size_t outlen, keccak_state *state)
+{
+  ts_squeeze(out, outlen, state, TURBOSHAKE256_RATE);
+}
+
+void turboshake256_final(uint8_t *out, size_t outlen, keccak_state *state, uint8_t ds)
+{
+  ts_finalize(state, TURBOSHAKE256_RATE, ds);
+  ts_squeeze(out, outlen, state, TURBOSHAKE256_RATE);
+}
+
+void turboshake128(uint8_t *out, size_t outlen,
+                   const uint8_t *in, size_t inlen, uint8_t ds)
+{
+  keccak_state state;
+
+  ts_init(&state);
+  ts_absorb(&state, TURBOSHAKE128_RATE, in, inlen);
+  ts_finalize(&state, TURBOSHAKE128_RATE, ds);
+  ts_squeeze(out, outlen, &state, TURBOSHAKE128_RATE);
+}
+
+void turboshake256(uint8_t *out, size_t outlen,
+                   const uint8_t *in, size_t inlen, uint8_t ds)
+{
+  keccak_state state;
+
+  ts_init(&state);
+  ts_absorb(&state, TURBOSHAKE256_RATE, in, inlen);
+  ts_finalize(&state, TURBOSHAKE256_RATE, ds);
+  ts_squeeze(out, outlen, &state, TURBOSHAKE256_RATE);
+}
@@ -0,0 +1,148 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "libpake.h"
+
+/*
+  The dispatch table: the variant descriptors (one per object built
+  by the Makefile, names as in its VARIANTS), the CPU features and
+  the timings of pake_init, which only report and select nothing.
+*/
+
+#define PAKE_VARIANT_LIST(X) \
+  X(chic512) X(chic512_tmp1) X(chic512_tmp2) X(chic512_tmp3b) \
+  X(chic768) X(chic768_tmp1) X(chic768_tmp2) X(chic768_tmp3b) \
+  X(chic1024) X(chic1024_tmp1) X(chic1024_tmp2) X(chic1024_tmp3b) \
+  X(noic512) X(noic512_tmp1) X(noic512_tmp2) X(noic512_tmp3b) \
+  X(noic768) X(noic768_tmp1) X(noic768_tmp2) X(noic768_tmp3b) \
+  X(noic1024) X(noic1024_tmp1) X(noic1024_tmp2) X(noic1024_tmp3b) \
+  X(tempo512) X(tempo512_tmp1) X(tempo512_tmp2) X(tempo512_tmp3b) \
+  X(tempo768) X(tempo768_tmp1) X(tempo768_tmp2) X(tempo768_tmp3b) \
+  X(tempo1024) X(tempo1024_tmp1) X(tempo1024_tmp2) X(tempo1024_tmp3b)
+
+#define PAKE_VARIANT_DECL(name) extern const pake_variant pake_variant_##name;
+PAKE_VARIANT_LIST(PAKE_VARIANT_DECL)
+
+#define PAKE_VARIANT_REF(name) &pake_variant_##name,
+static const pake_variant *const variants[] = {
+  PAKE_VARIANT_LIST(PAKE_VARIANT_REF)
+};
+
+#define NVARIANTS (sizeof(variants)/sizeof(variants[0]))
+
+// gen_vector calls per timing round, and rounds (the fastest counts)
+#define CALIBRATION_CALLS 16
+#define CALIBRATION_ROUNDS 5
+
+static struct {
+  int initialized;
+  unsigned int cpu;
+  double ns[NVARIANTS];
+} dispatch;
+
+static unsigned int detect_cpu(void)
+{
+  unsigned int cpu = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    cpu |= PAKE_CPU_AVX2;
+  if(__builtin_cpu_supports("aes"))
+    cpu |= PAKE_CPU_AES;
+  if(__builtin_cpu_supports("bmi2"))
+    cpu |= PAKE_CPU_BMI2;
+#endif
+  return cpu;
+}
+
+/*************************************************
+* Name:        calibrate
+*
+* Description: Nanoseconds per gen_vector call of v, the best of
+*              CALIBRATION_ROUNDS rounds after a warm-up one
+**************************************************/
+static double calibrate(const pake_variant *v)
+{
+  uint8_t seed[PAKE_SYMBYTES] = {0};
+  struct timespec start, stop;
+  double ns, best = 0;
+  unsigned int i, j;
+
+  for(i=0;i<=CALIBRATION_ROUNDS;i++) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(j=0;j<CALIBRATION_CALLS;j++) {
+      seed[0] = (uint8_t)j;
+      v->gen_vector(seed);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    ns = (1e9*(double)(stop.tv_sec - start.tv_sec)
+          + (double)(stop.tv_nsec - start.tv_nsec)) / CALIBRATION_CALLS;
+    if(i > 0 && (best == 0 || ns < best))
+      best = ns;
+  }
+  return best;
+}
+
+int pake_init(unsigned int flags)
+{
+  unsigned int i;
+
+  if(dispatch.initialized)
+    return 0;
+
+  dispatch.cpu = detect_cpu();
+  if(!(flags & PAKE_INIT_NO_CALIBRATION)) {
+    for(i=0;i<NVARIANTS;i++)
+      dispatch.ns[i] = calibrate(variants[i]);
+  }
+  dispatch.initialized = 1;
+  return 0;
+}
+
+unsigned int pake_cpu_features(void)
+{
+  return dispatch.cpu;
+}
+
+const pake_variant *pake_select(pake_construction construction,
+                                unsigned int k, unsigned int alg)
+{
+  unsigned int i;
+
+  for(i=0;i<NVARIANTS;i++) {
+    if(variants[i]->construction == construction && variants[i]->k == k
+       && variants[i]->vector_alg == alg)
+      return variants[i];
+  }
+  return NULL;
+}
+
+const pake_variant *pake_variant_by_name(const char *name)
+{
+  unsigned int i;
+
+  for(i=0;i<NVARIANTS;i++) {
+    if(strcmp(variants[i]->name, name) == 0)
+      return variants[i];
+  }
+  return NULL;
+}
+
+size_t pake_variants(const pake_variant *const **list)
+{
+  *list = variants;
+  return NVARIANTS;
+}
+
+double pake_calibration_ns(const pake_variant *v)
+{
+  unsigned int i;
+
+  for(i=0;i<NVARIANTS;i++) {
+    if(variants[i] == v)
+      return dispatch.ns[i];
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+#ifndef LIBPAKE_H
+#define LIBPAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  libpake: every construction (chic, noic, tempo), every KYBER_K and
+  every TEMPO_VECTOR_ALG of the ref trees in one library. Each variant
+  is the unchanged ../<construction>/ref code, compiled on its own and
+  linked into one relocatable object of which only the descriptor
+  pake_variant_<name> and the entry points pake_<name>_initStart,
+  _resp, _initEnd, _resp_batch and _initEnd_batch stay global (see
+  the Makefile), so that a process can hold all of them.
+
+  pake_init detects the CPU features the variants dispatch on and
+  times the mask expansion (gen_vector) of each variant. pake_select
+  returns a variant by construction, K and vector algorithm.
+
+  The vector algorithms compute different masks, so the two ends of
+  a handshake must run the same variant: the algorithm is an input
+  the application agrees on with its peer (pake_variant.name, or
+  construction, K and vector_alg), never picked by libpake. Within a
+  variant the implementation (x4 Keccak or single-state, AES-NI or
+  the portable AES) follows the CPU features and gives the same
+  bytes; the calibration only reports what it costs on this host.
+
+  randombytes is left to the application: libpake.a carries the
+  Kyber getrandom one, which a randombytes of the program (or
+  randbuf.o) linked before the library replaces.
+*/
+
+typedef enum {
+  PAKE_CHIC = 0,
+  PAKE_NOIC = 1,
+  PAKE_TEMPO = 2
+} pake_construction;
+
+#define PAKE_NCONSTRUCTIONS 3
+
+// TEMPO_VECTOR_ALG of a variant; 0 is the Kyber gen_vector layout
+#define PAKE_ALG_DEFAULT 0
+
+// CPU features the variants use when present
+#define PAKE_CPU_AVX2 0x1
+#define PAKE_CPU_AES  0x2
+#define PAKE_CPU_BMI2 0x4
+
+// pake_init flags
+#define PAKE_INIT_NO_CALIBRATION 0x1
+
+#define PAKE_SYMBYTES 32
+
+typedef struct {
+  const char *name;                 // e.g. "chic768", "tempo1024_tmp2"
+  pake_construction construction;
+  unsigned int k;                   // KYBER_K
+  unsigned int vector_alg;          // TEMPO_VECTOR_ALG, 0 if unset
+  size_t msg1_bytes;
+  size_t msg2_bytes;
+  size_t pk_bytes;
+  size_t sk_bytes;
+
+  // same contracts as in ../<construction>/ref/pake.h; key, pw and
+  // sid are PAKE_SYMBYTES long
+  void (*initStart)(uint8_t *msg1, uint8_t *pk, uint8_t *sk,
+                    const uint8_t *pw, const uint8_t *sid);
+  void (*resp)(uint8_t *key, uint8_t *msg2, const uint8_t *msg1,
+               const uint8_t *pw, const uint8_t *sid);
+  int (*initEnd)(uint8_t *key, const uint8_t *msg2, const uint8_t *msg1,
+                 const uint8_t *pk, const uint8_t *sk, const uint8_t *sid);
+
+  // n sessions, each argument n contiguous rows of the sizes above
+  void (*resp_batch)(uint8_t *key, uint8_t *msg2, const uint8_t *msg1,
+                     const uint8_t *pw, const uint8_t *sid, size_t n);
+  int (*initEnd_batch)(uint8_t *key, int *result, const uint8_t *msg2,
+                       const uint8_t *msg1, const uint8_t *pk,
+                       const uint8_t *sk, const uint8_t *sid, size_t n);
+
+  // the mask expansion of the variant into a scratch polyvec, for
+  // the calibration
+  void (*gen_vector)(const uint8_t seed[PAKE_SYMBYTES]);
+} pake_variant;
+
+/* detects the CPU features and, unless PAKE_INIT_NO_CALIBRATION is
+   set, times every variant's gen_vector. Call it once, before the
+   other functions and before starting threads. Returns 0 */
+int pake_init(unsigned int flags);
+
+/* PAKE_CPU_* bits of the running CPU */
+unsigned int pake_cpu_features(void);
+
+/* the variant of construction and k (2, 3 or 4) with vector
+   algorithm alg (PAKE_ALG_DEFAULT or a TEMPO_VECTOR_ALG value), NULL
+   if there is none */
+const pake_variant *pake_select(pake_construction construction,
+                                unsigned int k, unsigned int alg);
+
+/* the variant called name, or NULL */
+const pake_variant *pake_variant_by_name(const char *name);
+
+/* all variants: sets *list and returns their number */
+size_t pake_variants(const pake_variant *const **list);
+
+/* nanoseconds per gen_vector call measured by pake_init for v, 0 if
+   it did not calibrate */
+double pake_calibration_ns(const pake_variant *v);
+
+#endif
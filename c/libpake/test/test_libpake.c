@@ -0,0 +1,160 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../libpake.h"
+#include "randombytes.h"
+
+#define NTESTS 20
+#define NBATCH 5
+
+// large enough for any variant (tempo1024)
+#define MAXMSG1 (1568+32)
+#define MAXMSG2 (32+1568)
+#define MAXPK 1568
+#define MAXSK 3168
+
+static uint8_t pk[NBATCH][MAXPK];
+static uint8_t sk[NBATCH][MAXSK];
+static uint8_t msg1[NBATCH][MAXMSG1];
+static uint8_t msg2[NBATCH][MAXMSG2];
+
+static int test_sizes(const pake_variant *v)
+{
+  if(v->msg1_bytes > MAXMSG1 || v->msg2_bytes > MAXMSG2
+     || v->pk_bytes > MAXPK || v->sk_bytes > MAXSK) {
+    printf("ERROR %s sizes\n", v->name);
+    return 1;
+  }
+  return 0;
+}
+
+static int test_handshake(const pake_variant *v)
+{
+  uint8_t pw[PAKE_SYMBYTES], sid[PAKE_SYMBYTES];
+  uint8_t key_a[PAKE_SYMBYTES], key_b[PAKE_SYMBYTES];
+
+  randombytes(pw,PAKE_SYMBYTES);
+  randombytes(sid,PAKE_SYMBYTES);
+  v->initStart(msg1[0],pk[0],sk[0],pw,sid);
+  v->resp(key_b,msg2[0],msg1[0],pw,sid);
+  if(v->initEnd(key_a,msg2[0],msg1[0],pk[0],sk[0],sid)
+     || memcmp(key_a,key_b,PAKE_SYMBYTES)) {
+    printf("ERROR %s handshake\n", v->name);
+    return 1;
+  }
+  return 0;
+}
+
+// the flat-row batch entry points against the single calls
+static int test_batch(const pake_variant *v)
+{
+  uint8_t pw[NBATCH][PAKE_SYMBYTES], sid[NBATCH][PAKE_SYMBYTES];
+  uint8_t key_a[NBATCH][PAKE_SYMBYTES], key_b[NBATCH][PAKE_SYMBYTES];
+  uint8_t key[PAKE_SYMBYTES];
+  static uint8_t m1[NBATCH*MAXMSG1], m2[NBATCH*MAXMSG2];
+  static uint8_t p[NBATCH*MAXPK], s[NBATCH*MAXSK];
+  int result[NBATCH];
+  unsigned int i;
+
+  for(i=0;i<NBATCH;i++) {
+    randombytes(pw[i],PAKE_SYMBYTES);
+    randombytes(sid[i],PAKE_SYMBYTES);
+    v->initStart(m1+i*v->msg1_bytes,p+i*v->pk_bytes,s+i*v->sk_bytes,pw[i],sid[i]);
+  }
+  v->resp_batch(key_b[0],m2,m1,pw[0],sid[0],NBATCH);
+  if(v->initEnd_batch(key_a[0],result,m2,m1,p,s,sid[0],NBATCH)) {
+    printf("ERROR %s initEnd_batch\n", v->name);
+    return 1;
+  }
+  for(i=0;i<NBATCH;i++) {
+    if(memcmp(key_a[i],key_b[i],PAKE_SYMBYTES)
+       || v->initEnd(key,m2+i*v->msg2_bytes,m1+i*v->msg1_bytes,
+                     p+i*v->pk_bytes,s+i*v->sk_bytes,sid[i])
+       || memcmp(key,key_a[i],PAKE_SYMBYTES)) {
+      printf("ERROR %s batch\n", v->name);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// sessions of different variants interleaved in one process
+static int test_mixed(const pake_variant *const *list, size_t n)
+{
+  uint8_t pw[PAKE_SYMBYTES] = {0}, sid[PAKE_SYMBYTES] = {0};
+  uint8_t key_a[PAKE_SYMBYTES], key_b[PAKE_SYMBYTES];
+  const pake_variant *v[NBATCH];
+  unsigned int i;
+
+  for(i=0;i<NBATCH;i++) {
+    v[i] = list[(7*i+3) % n];
+    sid[0] = (uint8_t)i;
+    v[i]->initStart(msg1[i],pk[i],sk[i],pw,sid);
+  }
+  for(i=0;i<NBATCH;i++) {
+    sid[0] = (uint8_t)i;
+    v[i]->resp(key_b,msg2[i],msg1[i],pw,sid);
+    if(v[i]->initEnd(key_a,msg2[i],msg1[i],pk[i],sk[i],sid)
+       || memcmp(key_a,key_b,PAKE_SYMBYTES)) {
+      printf("ERROR mixed %s\n", v[i]->name);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int test_select(const pake_variant *const *list, size_t n)
+{
+  size_t i;
+
+  for(i=0;i<n;i++) {
+    if(pake_select(list[i]->construction,list[i]->k,list[i]->vector_alg) != list[i]
+       || pake_variant_by_name(list[i]->name) != list[i]) {
+      printf("ERROR select %s\n", list[i]->name);
+      return 1;
+    }
+  }
+  if(pake_select(PAKE_CHIC,5,PAKE_ALG_DEFAULT) != NULL
+     || pake_variant_by_name("chic") != NULL) {
+    printf("ERROR select missing\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(void)
+{
+  const pake_variant *const *list;
+  const pake_variant *v;
+  unsigned int cpu, j;
+  size_t n, i;
+
+  pake_init(0);
+  n = pake_variants(&list);
+  cpu = pake_cpu_features();
+  printf("%zu variants, cpu:%s%s%s\n", n,
+         cpu & PAKE_CPU_AVX2 ? " avx2" : "",
+         cpu & PAKE_CPU_AES ? " aes" : "",
+         cpu & PAKE_CPU_BMI2 ? " bmi2" : "");
+  if(n != 3*3*4)
+    return 1;
+
+  for(i=0;i<n;i++) {
+    v = list[i];
+    if(test_sizes(v))
+      return 1;
+    for(j=0;j<NTESTS;j++) {
+      if(test_handshake(v))
+        return 1;
+    }
+    if(test_batch(v))
+      return 1;
+  }
+  if(test_mixed(list,n) || test_select(list,n))
+    return 1;
+
+  for(i=0;i<n;i++)
+    printf("%-16s gen_vector %8.0f ns\n", list[i]->name, pake_calibration_ns(list[i]));
+  return 0;
+}
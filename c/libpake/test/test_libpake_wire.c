@@ -0,0 +1,85 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libpake.h"
+#include "fips202.h"
+#include "randombytes.h"
+
+#define NRUNS 32
+
+/*
+  The test_wire digest of a libpake variant: NRUNS handshakes on the
+  randombytes stream of ../<construction>/ref/test/test_wire.c, and
+  SHA3-256 over every msg1, msg2 and key. make wire compares it with
+  the standalone test_wire of each default variant.
+*/
+
+static uint64_t drbg_ctr;
+
+void randombytes(uint8_t *out, size_t outlen)
+{
+  uint8_t in[8];
+  unsigned int i;
+
+  for(i=0;i<8;i++)
+    in[i] = drbg_ctr >> 8*i;
+  drbg_ctr++;
+  shake256(out,outlen,in,8);
+}
+
+int main(int argc, char **argv)
+{
+  const pake_variant *v;
+  uint8_t pw[PAKE_SYMBYTES], sid[PAKE_SYMBYTES];
+  uint8_t key_a[PAKE_SYMBYTES], key_b[PAKE_SYMBYTES];
+  uint8_t h[32];
+  uint8_t *pk, *sk, *transcript, *t;
+  size_t len;
+  unsigned int i;
+
+  if(argc != 2) {
+    fprintf(stderr, "usage: %s variant\n", argv[0]);
+    return 1;
+  }
+  pake_init(PAKE_INIT_NO_CALIBRATION);
+  v = pake_variant_by_name(argv[1]);
+  if(v == NULL) {
+    fprintf(stderr, "no variant %s\n", argv[1]);
+    return 1;
+  }
+
+  len = v->msg1_bytes+v->msg2_bytes+PAKE_SYMBYTES;
+  pk = malloc(v->pk_bytes);
+  sk = malloc(v->sk_bytes);
+  transcript = malloc(NRUNS*len);
+  if(pk == NULL || sk == NULL || transcript == NULL)
+    return 1;
+
+  for(i=0;i<NRUNS;i++) {
+    t = transcript+i*len;
+    randombytes(pw,PAKE_SYMBYTES);
+    randombytes(sid,PAKE_SYMBYTES);
+
+    v->initStart(t,pk,sk,pw,sid);
+    v->resp(key_b,t+v->msg1_bytes,t,pw,sid);
+    v->initEnd(key_a,t+v->msg1_bytes,t,pk,sk,sid);
+    memcpy(t+v->msg1_bytes+v->msg2_bytes,key_a,PAKE_SYMBYTES);
+
+    if(memcmp(key_a,key_b,PAKE_SYMBYTES)) {
+      printf("ERROR keys\n");
+      return 1;
+    }
+  }
+  sha3_256(h,transcript,NRUNS*len);
+
+  for(i=0;i<32;i++)
+    printf("%02x",h[i]);
+  printf("\n");
+
+  free(pk);
+  free(sk);
+  free(transcript);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+#include "polyvec.h"
+#include "pake.h"
+#include "genx4.h"
+#include "rej_uniform.h"
+#include "libpake.h"
+
+/*
+  One libpake variant: built with -I ../<construction>/ref, KYBER_K,
+  TEMPO_VECTOR_ALG and PAKE_VARIANT (the variant name, e.g.
+  chic768_tmp1) and PAKE_CONSTRUCTION set, and linked with that
+  construction's sources into one object. The Makefile then keeps
+  pake_variant_<name> global, renames the entry points to
+  pake_<name>_* and localizes everything else.
+*/
+
+#ifdef TEMPO_VECTOR_ALG
+#define VARIANT_VECTOR_ALG TEMPO_VECTOR_ALG
+#else
+#define VARIANT_VECTOR_ALG 0
+#endif
+
+#define VARIANT_STR2(s) #s
+#define VARIANT_STR(s) VARIANT_STR2(s)
+#define VARIANT_CAT2(a, b) a##b
+#define VARIANT_CAT(a, b) VARIANT_CAT2(a, b)
+
+static void variant_resp_batch(uint8_t *key, uint8_t *msg2, const uint8_t *msg1,
+                               const uint8_t *pw, const uint8_t *sid, size_t n)
+{
+  resp_batch((uint8_t (*)[KYBER_SYMBYTES])key,
+             (uint8_t (*)[MSG2_LEN])msg2,
+             (const uint8_t (*)[MSG1_LEN])msg1,
+             (const uint8_t (*)[KYBER_SYMBYTES])pw,
+             (const uint8_t (*)[KYBER_SYMBYTES])sid,n);
+}
+
+static int variant_initEnd_batch(uint8_t *key, int *result, const uint8_t *msg2,
+                                 const uint8_t *msg1, const uint8_t *pk,
+                                 const uint8_t *sk, const uint8_t *sid, size_t n)
+{
+  return initEnd_batch((uint8_t (*)[KYBER_SYMBYTES])key,result,
+                       (const uint8_t (*)[MSG2_LEN])msg2,
+                       (const uint8_t (*)[MSG1_LEN])msg1,
+                       (const uint8_t (*)[KYBER_PUBLICKEYBYTES])pk,
+                       (const uint8_t (*)[KYBER_SECRETKEYBYTES])sk,
+                       (const uint8_t (*)[KYBER_SYMBYTES])sid,n);
+}
+
+static void variant_gen_vector(const uint8_t seed[PAKE_SYMBYTES])
+{
+  static polyvec a;
+
+  pake_gen_vector(&a,seed);
+}
+
+const pake_variant VARIANT_CAT(pake_variant_, PAKE_VARIANT) = {
+  VARIANT_STR(PAKE_VARIANT),
+  PAKE_CONSTRUCTION,
+  KYBER_K,
+  VARIANT_VECTOR_ALG,
+  MSG1_LEN,
+  MSG2_LEN,
+  KYBER_PUBLICKEYBYTES,
+  KYBER_SECRETKEYBYTES,
+  initStart,
+  resp,
+  initEnd,
+  variant_resp_batch,
+  variant_initEnd_batch,
+  variant_gen_vector
+};
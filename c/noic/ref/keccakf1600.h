@@ -0,0 +1,32 @@
+#ifndef KECCAKF1600_H
+#define KECCAKF1600_H
+
+#include <stdint.h>
+
+/*
+  Single-state Keccak-f[1600] for the SHA3 hashes of the
+  constructions (sha3inc.c). Both versions are fully unrolled,
+  with the state in 25 locals ping-ponging between two round
+  bodies:
+  - KeccakF1600_StatePermute_compl keeps six lanes complemented
+    (the "bebigokimisa" pattern) so that chi needs one NOT per
+    plane instead of five, for CPUs without ANDN;
+  - KeccakF1600_StatePermute_fast uses the plain chi, built for
+    BMI1/BMI2 (ANDN, RORX), when the CPU has them, and falls back
+    to the complemented one otherwise.
+  Same output as the fips202.c permutation; the state layout is
+  that of keccak_state.s.
+
+  KeccakP1600_12_* are the 12-round Keccak-p[1600,12] of
+  TurboSHAKE (turboshake.h), rounds 12 to 23 of the above.
+*/
+
+void KeccakF1600_StatePermute_compl(uint64_t s[25]);
+void KeccakF1600_StatePermute_fast(uint64_t s[25]);
+
+void KeccakP1600_12_StatePermute_compl(uint64_t s[25]);
+void KeccakP1600_12_StatePermute_fast(uint64_t s[25]);
+
+int keccakf1600_bmi_available(void);
+
+#endif
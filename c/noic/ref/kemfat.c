@@ -0,0 +1,287 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "params.h"
+#include "genx4.h"
+#include "indcpa.h"
+#include "kemfat.h"
+#include "poly.h"
+#include "polyvec.h"
+#include "randombytes.h"
+#include "sha3inc.h"
+#include "symmetric.h"
+#include "verify.h"
+
+/*************************************************
+* Name:        kem_fat_keypair_derand
+*
+* Description: crypto_kem_keypair_derand, keeping the expanded
+*              matrix and the NTT-domain vectors in sk
+*
+* Results:     uint8_t *pk: the packed public key
+*                 (of length KYBER_PUBLICKEYBYTES)
+*              kem_fat_sk *sk: the unpacked secret key
+*
+* Arguments:   uint8_t *coins: d||z
+*                 (of length 2*KYBER_SYMBYTES)
+**************************************************/
+void kem_fat_keypair_derand(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                            kem_fat_sk *sk,
+                            const uint8_t coins[2*KYBER_SYMBYTES])
+{
+  unsigned int i, j;
+  uint8_t buf[2*KYBER_SYMBYTES];
+  const uint8_t *publicseed = buf;
+  const uint8_t *noiseseed = buf+KYBER_SYMBYTES;
+  uint8_t nonce = 0;
+  polyvec a[KYBER_K], e;
+
+  memcpy(buf,coins,KYBER_SYMBYTES);
+  buf[KYBER_SYMBYTES] = KYBER_K;
+  pake_hash_g(buf,buf,KYBER_SYMBYTES+1);
+
+  pake_gen_matrix(a,publicseed,0);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta1(&sk->skpv.vec[i],noiseseed,nonce++);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta1(&e.vec[i],noiseseed,nonce++);
+
+  polyvec_ntt(&sk->skpv);
+  polyvec_ntt(&e);
+
+  for(i=0;i<KYBER_K;i++) {
+    polyvec_basemul_acc_montgomery(&sk->pkpv.vec[i],&a[i],&sk->skpv);
+    poly_tomont(&sk->pkpv.vec[i]);
+  }
+  polyvec_add(&sk->pkpv,&sk->pkpv,&e);
+  polyvec_reduce(&sk->pkpv);
+
+  // the re-encryption in kem_fat_dec multiplies by A^T
+  for(i=0;i<KYBER_K;i++)
+    for(j=0;j<KYBER_K;j++)
+      sk->at[i].vec[j] = a[j].vec[i];
+
+  polyvec_tobytes(pk,&sk->pkpv);
+  memcpy(pk+KYBER_POLYVECBYTES,publicseed,KYBER_SYMBYTES);
+
+  pake_hash_h(sk->hpk,pk,KYBER_PUBLICKEYBYTES);
+  memcpy(sk->z,coins+KYBER_SYMBYTES,KYBER_SYMBYTES);
+}
+
+/*************************************************
+* Name:        kem_fat_keypair
+*
+* Description: kem_fat_keypair_derand with fresh coins
+**************************************************/
+void kem_fat_keypair(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                     kem_fat_sk *sk)
+{
+  uint8_t coins[2*KYBER_SYMBYTES];
+
+  randombytes(coins,2*KYBER_SYMBYTES);
+  kem_fat_keypair_derand(pk,sk,coins);
+}
+
+/*************************************************
+* Name:        enc_unpacked
+*
+* Description: indcpa_enc from an unpacked public key: A^T and t in
+*              the NTT domain
+**************************************************/
+static void enc_unpacked(uint8_t c[KYBER_INDCPA_BYTES],
+                         const uint8_t m[KYBER_INDCPA_MSGBYTES],
+                         const polyvec at[KYBER_K],
+                         const polyvec *pkpv,
+                         const uint8_t coins[KYBER_SYMBYTES])
+{
+  unsigned int i;
+  uint8_t nonce = 0;
+  polyvec sp, ep, b;
+  poly v, k, epp;
+
+  poly_frommsg(&k,m);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta1(&sp.vec[i],coins,nonce++);
+  for(i=0;i<KYBER_K;i++)
+    poly_getnoise_eta2(&ep.vec[i],coins,nonce++);
+  poly_getnoise_eta2(&epp,coins,nonce++);
+
+  polyvec_ntt(&sp);
+
+  for(i=0;i<KYBER_K;i++)
+    polyvec_basemul_acc_montgomery(&b.vec[i],&at[i],&sp);
+  polyvec_basemul_acc_montgomery(&v,pkpv,&sp);
+
+  polyvec_invntt_tomont(&b);
+  poly_invntt_tomont(&v);
+
+  polyvec_add(&b,&b,&ep);
+  poly_add(&v,&v,&epp);
+  poly_add(&v,&v,&k);
+  polyvec_reduce(&b);
+  poly_reduce(&v);
+
+  polyvec_compress(c,&b);
+  poly_compress(c+KYBER_POLYVECCOMPRESSEDBYTES,&v);
+}
+
+// kem_enc_unpacked_derand with H(pk) already computed
+static void kem_enc_unpacked_hpk(uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                                 uint8_t ss[KYBER_SSBYTES],
+                                 const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                                 const polyvec *pkpv,
+                                 const uint8_t hpk[KYBER_SYMBYTES],
+                                 const uint8_t coins[KYBER_SYMBYTES])
+{
+  uint8_t buf[2*KYBER_SYMBYTES];
+  uint8_t kr[2*KYBER_SYMBYTES];
+  polyvec at[KYBER_K];
+
+  memcpy(buf,coins,KYBER_SYMBYTES);
+  memcpy(buf+KYBER_SYMBYTES,hpk,KYBER_SYMBYTES);
+  pake_hash_g(kr,buf,2*KYBER_SYMBYTES);
+
+  pake_gen_matrix(at,pk+KYBER_POLYVECBYTES,1);
+  enc_unpacked(ct,buf,at,pkpv,kr+KYBER_SYMBYTES);
+
+  memcpy(ss,kr,KYBER_SYMBYTES);
+}
+
+/*************************************************
+* Name:        kem_enc_unpacked_derand
+*
+* Description: crypto_kem_enc_derand with t given unpacked
+*
+* Results:     uint8_t *ct: the ciphertext
+*                 (of length KYBER_CIPHERTEXTBYTES)
+*              uint8_t *ss: the shared secret
+*                 (of length KYBER_SSBYTES)
+*
+* Arguments:   uint8_t *pk: the packed public key
+*                 (of length KYBER_PUBLICKEYBYTES)
+*              polyvec *pkpv: t as packed in pk (any representatives
+*                 mod q, e.g. polyvec_reduce output)
+*              uint8_t *coins: the encapsulation randomness
+*                 (of length KYBER_SYMBYTES)
+**************************************************/
+void kem_enc_unpacked_derand(uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                             uint8_t ss[KYBER_SSBYTES],
+                             const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                             const polyvec *pkpv,
+                             const uint8_t coins[KYBER_SYMBYTES])
+{
+  uint8_t hpk[KYBER_SYMBYTES];
+
+  pake_hash_h(hpk,pk,KYBER_PUBLICKEYBYTES);
+  kem_enc_unpacked_hpk(ct,ss,pk,pkpv,hpk,coins);
+}
+
+/*************************************************
+* Name:        kem_enc_unpacked
+*
+* Description: kem_enc_unpacked_derand with fresh coins
+**************************************************/
+void kem_enc_unpacked(uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                      uint8_t ss[KYBER_SSBYTES],
+                      const uint8_t pk[KYBER_PUBLICKEYBYTES],
+                      const polyvec *pkpv)
+{
+  uint8_t coins[KYBER_SYMBYTES];
+
+  randombytes(coins,KYBER_SYMBYTES);
+  kem_enc_unpacked_derand(ct,ss,pk,pkpv,coins);
+}
+
+/*************************************************
+* Name:        kem_enc_unpacked_xN
+*
+* Description: kem_enc_unpacked for n independent public keys, with
+*              H(pk) four at a time on the four-lane Keccak (one
+*              left over goes to the single-state one). Coins
+*              are drawn in session order, as n calls to
+*              kem_enc_unpacked would
+*
+* Results:     uint8_t (*ct): n ciphertexts
+*              uint8_t (*ss): n shared secrets
+*
+* Arguments:   uint8_t (*pk): n packed public keys
+*              polyvec *pkpv: n unpacked t, as for kem_enc_unpacked
+*              size_t n: number of public keys
+**************************************************/
+void kem_enc_unpacked_xN(uint8_t (*ct)[KYBER_CIPHERTEXTBYTES],
+                         uint8_t (*ss)[KYBER_SSBYTES],
+                         const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                         const polyvec *pkpv,
+                         size_t n)
+{
+  uint8_t coins[KYBER_SYMBYTES];
+  uint8_t hpk[4][KYBER_SYMBYTES];
+  const uint8_t *in[4];
+  uint8_t *out[4];
+  keccakx4_state state;
+  size_t i;
+  unsigned int l, k;
+
+  for(i=0;i<n;i+=k) {
+    k = n-i < 4 ? n-i : 4;
+    if(k == 1) {
+      pake_hash_h(hpk[0],pk[i],KYBER_PUBLICKEYBYTES);
+    } else {
+      // unused lanes hash the first pk of the group again
+      for(l=0;l<4;l++) {
+        in[l] = pk[i + (l < k ? l : 0)];
+        out[l] = hpk[l];
+      }
+      hash_hx4_init(&state);
+      hash_hx4_absorb(&state,in,KYBER_PUBLICKEYBYTES);
+      hash_hx4_final(out,&state);
+    }
+
+    for(l=0;l<k;l++) {
+      randombytes(coins,KYBER_SYMBYTES);
+      kem_enc_unpacked_hpk(ct[i+l],ss[i+l],pk[i+l],&pkpv[i+l],hpk[l],coins);
+    }
+  }
+}
+
+/*************************************************
+* Name:        kem_fat_dec
+*
+* Description: crypto_kem_dec from the unpacked secret key
+*
+* Results:     uint8_t *ss: the shared secret
+*                 (of length KYBER_SSBYTES)
+*
+* Arguments:   uint8_t *ct: the ciphertext
+*                 (of length KYBER_CIPHERTEXTBYTES)
+*              kem_fat_sk *sk: the unpacked secret key
+**************************************************/
+void kem_fat_dec(uint8_t ss[KYBER_SSBYTES],
+                 const uint8_t ct[KYBER_CIPHERTEXTBYTES],
+                 const kem_fat_sk *sk)
+{
+  int fail;
+  uint8_t buf[2*KYBER_SYMBYTES];
+  uint8_t kr[2*KYBER_SYMBYTES];
+  uint8_t cmp[KYBER_CIPHERTEXTBYTES];
+  polyvec b;
+  poly v, mp;
+
+  polyvec_decompress(&b,ct);
+  poly_decompress(&v,ct+KYBER_POLYVECCOMPRESSEDBYTES);
+  polyvec_ntt(&b);
+  polyvec_basemul_acc_montgomery(&mp,&sk->skpv,&b);
+  poly_invntt_tomont(&mp);
+  poly_sub(&mp,&v,&mp);
+  poly_reduce(&mp);
+  poly_tomsg(buf,&mp);
+
+  memcpy(buf+KYBER_SYMBYTES,sk->hpk,KYBER_SYMBYTES);
+  pake_hash_g(kr,buf,2*KYBER_SYMBYTES);
+
+  enc_unpacked(cmp,buf,sk->at,&sk->pkpv,kr+KYBER_SYMBYTES);
+  fail = verify(ct,cmp,KYBER_CIPHERTEXTBYTES);
+
+  rkprf(ss,sk->z,ct);
+  cmov(ss,kr,KYBER_SYMBYTES,!fail);
+}
@@ -0,0 +1,38 @@
+#ifndef KEYPOOL_H
+#define KEYPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+
+/*
+  Pool of ML-KEM keypairs generated ahead of time by a background
+  thread. Keygen does not depend on the password, so initStartPool
+  can take a ready keypair and leave only the password-dependent
+  part on the critical path. Keypairs sit in a bounded lock-free
+  ring (one slot per keypair, Vyukov-style sequence numbers), which
+  any number of threads may pop from concurrently.
+*/
+
+typedef struct keypool keypool;
+
+/* starts the generator thread; capacity is rounded up to a power of
+   two. Returns NULL on failure. */
+keypool *keypool_new(size_t capacity);
+
+/* stops the generator thread and frees the pool */
+void keypool_free(keypool *pool);
+
+/* moves one keypair out of the pool: 0 on a hit, -1 if the pool was
+   empty (pk and sk are left untouched) */
+int keypool_pop(keypool *pool,
+                uint8_t pk[KYBER_PUBLICKEYBYTES],
+                uint8_t sk[KYBER_SECRETKEYBYTES]);
+
+/* number of keypairs ready to be popped (a snapshot) */
+size_t keypool_available(keypool *pool);
+
+/* number of keypool_pop hits and misses so far */
+void keypool_stats(keypool *pool, uint64_t *hits, uint64_t *misses);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef POLYMASK_H
+#define POLYMASK_H
+
+#include <stdint.h>
+#include "params.h"
+#include "poly.h"
+#include "polyvec.h"
+
+/*
+  Password masking of the packed vector part of a public key in one
+  pass: unpack 12-bit coefficients, add (resp. subtract) the mask,
+  reduce to [0,q) and pack again. Same bytes as polyvec_frombytes,
+  polyvec_add/polyvec_sub, polyvec_reduce and polyvec_tobytes in a
+  row; the unpacked result of the subtraction, if asked for, is the
+  same mod q. AVX2 when the CPU has it (genx4_available), scalar
+  otherwise.
+*/
+
+void poly_mask_add(uint8_t r[KYBER_POLYBYTES],
+                   const uint8_t a[KYBER_POLYBYTES],
+                   const poly *m);
+
+void poly_mask_sub(uint8_t r[KYBER_POLYBYTES],
+                   poly *rp,
+                   const uint8_t a[KYBER_POLYBYTES],
+                   const poly *m);
+
+void polyvec_mask_add(uint8_t r[KYBER_POLYVECBYTES],
+                      const uint8_t a[KYBER_POLYVECBYTES],
+                      const polyvec *m);
+
+void polyvec_mask_sub(uint8_t r[KYBER_POLYVECBYTES],
+                      polyvec *rp,
+                      const uint8_t a[KYBER_POLYVECBYTES],
+                      const polyvec *m);
+
+#endif
@@ -0,0 +1,379 @@
+#include <stdint.h>
+#include "params.h"
+#include "genx4.h"
+#include "rejavx2.h"
+#include "rej_uniform.h"
+
+#ifdef GENX4
+
+#include <immintrin.h>
+
+#define REJAVX2_TARGET __attribute__((target("avx2,popcnt")))
+
+// byte offsets of the 16-bit lanes set in the index, -1 padded
+static const int8_t rejavx2_idx[256][8] = {
+  {-1, -1, -1, -1, -1, -1, -1, -1},
+  { 0, -1, -1, -1, -1, -1, -1, -1},
+  { 2, -1, -1, -1, -1, -1, -1, -1},
+  { 0,  2, -1, -1, -1, -1, -1, -1},
+  { 4, -1, -1, -1, -1, -1, -1, -1},
+  { 0,  4, -1, -1, -1, -1, -1, -1},
+  { 2,  4, -1, -1, -1, -1, -1, -1},
+  { 0,  2,  4, -1, -1, -1, -1, -1},
+  { 6, -1, -1, -1, -1, -1, -1, -1},
+  { 0,  6, -1, -1, -1, -1, -1, -1},
+  { 2,  6, -1, -1, -1, -1, -1, -1},
+  { 0,  2,  6, -1, -1, -1, -1, -1},
+  { 4,  6, -1, -1, -1, -1, -1, -1},
+  { 0,  4,  6, -1, -1, -1, -1, -1},
+  { 2,  4,  6, -1, -1, -1, -1, -1},
+  { 0,  2,  4,  6, -1, -1, -1, -1},
+  { 8, -1, -1, -1, -1, -1, -1, -1},
+  { 0,  8, -1, -1, -1, -1, -1, -1},
+  { 2,  8, -1, -1, -1, -1, -1, -1},
+  { 0,  2,  8, -1, -1, -1, -1, -1},
+  { 4,  8, -1, -1, -1, -1, -1, -1},
+  { 0,  4,  8, -1, -1, -1, -1, -1},
+  { 2,  4,  8, -1, -1, -1, -1, -1},
+  { 0,  2,  4,  8, -1, -1, -1, -1},
+  { 6,  8, -1, -1, -1, -1, -1, -1},
+  { 0,  6,  8, -1, -1, -1, -1, -1},
+  { 2,  6,  8, -1, -1, -1, -1, -1},
+  { 0,  2,  6,  8, -1, -1, -1, -1},
+  { 4,  6,  8, -1, -1, -1, -1, -1},
+  { 0,  4,  6,  8, -1, -1, -1, -1},
+  { 2,  4,  6,  8, -1, -1, -1, -1},
+  { 0,  2,  4,  6,  8, -1, -1, -1},
+  {10, -1, -1, -1, -1, -1, -1, -1},
+  { 0, 10, -1, -1, -1, -1, -1, -1},
+  { 2, 10, -1, -1, -1, -1, -1, -1},
+  { 0,  2, 10, -1, -1, -1, -1, -1},
+  { 4, 10, -1, -1, -1, -1, -1, -1},
+  { 0,  4, 10, -1, -1, -1, -1, -1},
+  { 2,  4, 10, -1, -1, -1, -1, -1},
+  { 0,  2,  4, 10, -1, -1, -1, -1},
+  { 6, 10, -1, -1, -1, -1, -1, -1},
+  { 0,  6, 10, -1, -1, -1, -1, -1},
+  { 2,  6, 10, -1, -1, -1, -1, -1},
+  { 0,  2,  6, 10, -1, -1, -1, -1},
+  { 4,  6, 10, -1, -1, -1, -1, -1},
+  { 0,  4,  6, 10, -1, -1, -1, -1},
+  { 2,  4,  6, 10, -1, -1, -1, -1},
+  { 0,  2,  4,  6, 10, -1, -1, -1},
+  { 8, 10, -1, -1, -1, -1, -1, -1},
+  { 0,  8, 10, -1, -1, -1, -1, -1},
+  { 2,  8, 10, -1, -1, -1, -1, -1},
+  { 0,  2,  8, 10, -1, -1, -1, -1},
+  { 4,  8, 10, -1, -1, -1, -1, -1},
+  { 0,  4,  8, 10, -1, -1, -1, -1},
+  { 2,  4,  8, 10, -1, -1, -1, -1},
+  { 0,  2,  4,  8, 10, -1, -1, -1},
+  { 6,  8, 10, -1, -1, -1, -1, -1},
+  { 0,  6,  8, 10, -1, -1, -1, -1},
+  { 2,  6,  8, 10, -1, -1, -1, -1},
+  { 0,  2,  6,  8, 10, -1, -1, -1},
+  { 4,  6,  8, 10, -1, -1, -1, -1},
+  { 0,  4,  6,  8, 10, -1, -1, -1},
+  { 2,  4,  6,  8, 10, -1, -1, -1},
+  { 0,  2,  4,  6,  8, 10, -1, -1},
+  {12, -1, -1, -1, -1, -1, -1, -1},
+  { 0, 12, -1, -1, -1, -1, -1, -1},
+  { 2, 12, -1, -1, -1, -1, -1, -1},
+  { 0,  2, 12, -1, -1, -1, -1, -1},
+  { 4, 12, -1, -1, -1, -1, -1, -1},
+  { 0,  4, 12, -1, -1, -1, -1, -1},
+  { 2,  4, 12, -1, -1, -1, -1, -1},
+  { 0,  2,  4, 12, -1, -1, -1, -1},
+  { 6, 12, -1, -1, -1, -1, -1, -1},
+  { 0,  6, 12, -1, -1, -1, -1, -1},
+  { 2,  6, 12, -1, -1, -1, -1, -1},
+  { 0,  2,  6, 12, -1, -1, -1, -1},
+  { 4,  6, 12, -1, -1, -1, -1, -1},
+  { 0,  4,  6, 12, -1, -1, -1, -1},
+  { 2,  4,  6, 12, -1, -1, -1, -1},
+  { 0,  2,  4,  6, 12, -1, -1, -1},
+  { 8, 12, -1, -1, -1, -1, -1, -1},
+  { 0,  8, 12, -1, -1, -1, -1, -1},
+  { 2,  8, 12, -1, -1, -1, -1, -1},
+  { 0,  2,  8, 12, -1, -1, -1, -1},
+  { 4,  8, 12, -1, -1, -1, -1, -1},
+  { 0,  4,  8, 12, -1, -1, -1, -1},
+  { 2,  4,  8, 12, -1, -1, -1, -1},
+  { 0,  2,  4,  8, 12, -1, -1, -1},
+  { 6,  8, 12, -1, -1, -1, -1, -1},
+  { 0,  6,  8, 12, -1, -1, -1, -1},
+  { 2,  6,  8, 12, -1, -1, -1, -1},
+  { 0,  2,  6,  8, 12, -1, -1, -1},
+  { 4,  6,  8, 12, -1, -1, -1, -1},
+  { 0,  4,  6,  8, 12, -1, -1, -1},
+  { 2,  4,  6,  8, 12, -1, -1, -1},
+  { 0,  2,  4,  6,  8, 12, -1, -1},
+  {10, 12, -1, -1, -1, -1, -1, -1},
+  { 0, 10, 12, -1, -1, -1, -1, -1},
+  { 2, 10, 12, -1, -1, -1, -1, -1},
+  { 0,  2, 10, 12, -1, -1, -1, -1},
+  { 4, 10, 12, -1, -1, -1, -1, -1},
+  { 0,  4, 10, 12, -1, -1, -1, -1},
+  { 2,  4, 10, 12, -1, -1, -1, -1},
+  { 0,  2,  4, 10, 12, -1, -1, -1},
+  { 6, 10, 12, -1, -1, -1, -1, -1},
+  { 0,  6, 10, 12, -1, -1, -1, -1},
+  { 2,  6, 10, 12, -1, -1, -1, -1},
+  { 0,  2,  6, 10, 12, -1, -1, -1},
+  { 4,  6, 10, 12, -1, -1, -1, -1},
+  { 0,  4,  6, 10, 12, -1, -1, -1},
+  { 2,  4,  6, 10, 12, -1, -1, -1},
+  { 0,  2,  4,  6, 10, 12, -1, -1},
+  { 8, 10, 12, -1, -1, -1, -1, -1},
+  { 0,  8, 10, 12, -1, -1, -1, -1},
+  { 2,  8, 10, 12, -1, -1, -1, -1},
+  { 0,  2,  8, 10, 12, -1, -1, -1},
+  { 4,  8, 10, 12, -1, -1, -1, -1},
+  { 0,  4,  8, 10, 12, -1, -1, -1},
+  { 2,  4,  8, 10, 12, -1, -1, -1},
+  { 0,  2,  4,  8, 10, 12, -1, -1},
+  { 6,  8, 10, 12, -1, -1, -1, -1},
+  { 0,  6,  8, 10, 12, -1, -1, -1},
+  { 2,  6,  8, 10, 12, -1, -1, -1},
+  { 0,  2,  6,  8, 10, 12, -1, -1},
+  { 4,  6,  8, 10, 12, -1, -1, -1},
+  { 0,  4,  6,  8, 10, 12, -1, -1},
+  { 2,  4,  6,  8, 10, 12, -1, -1},
+  { 0,  2,  4,  6,  8, 10, 12, -1},
+  {14, -1, -1, -1, -1, -1, -1, -1},
+  { 0, 14, -1, -1, -1, -1, -1, -1},
+  { 2, 14, -1, -1, -1, -1, -1, -1},
+  { 0,  2, 14, -1, -1, -1, -1, -1},
+  { 4, 14, -1, -1, -1, -1, -1, -1},
+  { 0,  4, 14, -1, -1, -1, -1, -1},
+  { 2,  4, 14, -1, -1, -1, -1, -1},
+  { 0,  2,  4, 14, -1, -1, -1, -1},
+  { 6, 14, -1, -1, -1, -1, -1, -1},
+  { 0,  6, 14, -1, -1, -1, -1, -1},
+  { 2,  6, 14, -1, -1, -1, -1, -1},
+  { 0,  2,  6, 14, -1, -1, -1, -1},
+  { 4,  6, 14, -1, -1, -1, -1, -1},
+  { 0,  4,  6, 14, -1, -1, -1, -1},
+  { 2,  4,  6, 14, -1, -1, -1, -1},
+  { 0,  2,  4,  6, 14, -1, -1, -1},
+  { 8, 14, -1, -1, -1, -1, -1, -1},
+  { 0,  8, 14, -1, -1, -1, -1, -1},
+  { 2,  8, 14, -1, -1, -1, -1, -1},
+  { 0,  2,  8, 14, -1, -1, -1, -1},
+  { 4,  8, 14, -1, -1, -1, -1, -1},
+  { 0,  4,  8, 14, -1, -1, -1, -1},
+  { 2,  4,  8, 14, -1, -1, -1, -1},
+  { 0,  2,  4,  8, 14, -1, -1, -1},
+  { 6,  8, 14, -1, -1, -1, -1, -1},
+  { 0,  6,  8, 14, -1, -1, -1, -1},
+  { 2,  6,  8, 14, -1, -1, -1, -1},
+  { 0,  2,  6,  8, 14, -1, -1, -1},
+  { 4,  6,  8, 14, -1, -1, -1, -1},
+  { 0,  4,  6,  8, 14, -1, -1, -1},
+  { 2,  4,  6,  8, 14, -1, -1, -1},
+  { 0,  2,  4,  6,  8, 14, -1, -1},
+  {10, 14, -1, -1, -1, -1, -1, -1},
+  { 0, 10, 14, -1, -1, -1, -1, -1},
+  { 2, 10, 14, -1, -1, -1, -1, -1},
+  { 0,  2, 10, 14, -1, -1, -1, -1},
+  { 4, 10, 14, -1, -1, -1, -1, -1},
+  { 0,  4, 10, 14, -1, -1, -1, -1},
+  { 2,  4, 10, 14, -1, -1, -1, -1},
+  { 0,  2,  4, 10, 14, -1, -1, -1},
+  { 6, 10, 14, -1, -1, -1, -1, -1},
+  { 0,  6, 10, 14, -1, -1, -1, -1},
+  { 2,  6, 10, 14, -1, -1, -1, -1},
+  { 0,  2,  6, 10, 14, -1, -1, -1},
+  { 4,  6, 10, 14, -1, -1, -1, -1},
+  { 0,  4,  6, 10, 14, -1, -1, -1},
+  { 2,  4,  6, 10, 14, -1, -1, -1},
+  { 0,  2,  4,  6, 10, 14, -1, -1},
+  { 8, 10, 14, -1, -1, -1, -1, -1},
+  { 0,  8, 10, 14, -1, -1, -1, -1},
+  { 2,  8, 10, 14, -1, -1, -1, -1},
+  { 0,  2,  8, 10, 14, -1, -1, -1},
+  { 4,  8, 10, 14, -1, -1, -1, -1},
+  { 0,  4,  8, 10, 14, -1, -1, -1},
+  { 2,  4,  8, 10, 14, -1, -1, -1},
+  { 0,  2,  4,  8, 10, 14, -1, -1},
+  { 6,  8, 10, 14, -1, -1, -1, -1},
+  { 0,  6,  8, 10, 14, -1, -1, -1},
+  { 2,  6,  8, 10, 14, -1, -1, -1},
+  { 0,  2,  6,  8, 10, 14, -1, -1},
+  { 4,  6,  8, 10, 14, -1, -1, -1},
+  { 0,  4,  6,  8, 10, 14, -1, -1},
+  { 2,  4,  6,  8, 10, 14, -1, -1},
+  { 0,  2,  4,  6,  8, 10, 14, -1},
+  {12, 14, -1, -1, -1, -1, -1, -1},
+  { 0, 12, 14, -1, -1, -1, -1, -1},
+  { 2, 12, 14, -1, -1, -1, -1, -1},
+  { 0,  2, 12, 14, -1, -1, -1, -1},
+  { 4, 12, 14, -1, -1, -1, -1, -1},
+  { 0,  4, 12, 14, -1, -1, -1, -1},
+  { 2,  4, 12, 14, -1, -1, -1, -1},
+  { 0,  2,  4, 12, 14, -1, -1, -1},
+  { 6, 12, 14, -1, -1, -1, -1, -1},
+  { 0,  6, 12, 14, -1, -1, -1, -1},
+  { 2,  6, 12, 14, -1, -1, -1, -1},
+  { 0,  2,  6, 12, 14, -1, -1, -1},
+  { 4,  6, 12, 14, -1, -1, -1, -1},
+  { 0,  4,  6, 12, 14, -1, -1, -1},
+  { 2,  4,  6, 12, 14, -1, -1, -1},
+  { 0,  2,  4,  6, 12, 14, -1, -1},
+  { 8, 12, 14, -1, -1, -1, -1, -1},
+  { 0,  8, 12, 14, -1, -1, -1, -1},
+  { 2,  8, 12, 14, -1, -1, -1, -1},
+  { 0,  2,  8, 12, 14, -1, -1, -1},
+  { 4,  8, 12, 14, -1, -1, -1, -1},
+  { 0,  4,  8, 12, 14, -1, -1, -1},
+  { 2,  4,  8, 12, 14, -1, -1, -1},
+  { 0,  2,  4,  8, 12, 14, -1, -1},
+  { 6,  8, 12, 14, -1, -1, -1, -1},
+  { 0,  6,  8, 12, 14, -1, -1, -1},
+  { 2,  6,  8, 12, 14, -1, -1, -1},
+  { 0,  2,  6,  8, 12, 14, -1, -1},
+  { 4,  6,  8, 12, 14, -1, -1, -1},
+  { 0,  4,  6,  8, 12, 14, -1, -1},
+  { 2,  4,  6,  8, 12, 14, -1, -1},
+  { 0,  2,  4,  6,  8, 12, 14, -1},
+  {10, 12, 14, -1, -1, -1, -1, -1},
+  { 0, 10, 12, 14, -1, -1, -1, -1},
+  { 2, 10, 12, 14, -1, -1, -1, -1},
+  { 0,  2, 10, 12, 14, -1, -1, -1},
+  { 4, 10, 12, 14, -1, -1, -1, -1},
+  { 0,  4, 10, 12, 14, -1, -1, -1},
+  { 2,  4, 10, 12, 14, -1, -1, -1},
+  { 0,  2,  4, 10, 12, 14, -1, -1},
+  { 6, 10, 12, 14, -1, -1, -1, -1},
+  { 0,  6, 10, 12, 14, -1, -1, -1},
+  { 2,  6, 10, 12, 14, -1, -1, -1},
+  { 0,  2,  6, 10, 12, 14, -1, -1},
+  { 4,  6, 10, 12, 14, -1, -1, -1},
+  { 0,  4,  6, 10, 12, 14, -1, -1},
+  { 2,  4,  6, 10, 12, 14, -1, -1},
+  { 0,  2,  4,  6, 10, 12, 14, -1},
+  { 8, 10, 12, 14, -1, -1, -1, -1},
+  { 0,  8, 10, 12, 14, -1, -1, -1},
+  { 2,  8, 10, 12, 14, -1, -1, -1},
+  { 0,  2,  8, 10, 12, 14, -1, -1},
+  { 4,  8, 10, 12, 14, -1, -1, -1},
+  { 0,  4,  8, 10, 12, 14, -1, -1},
+  { 2,  4,  8, 10, 12, 14, -1, -1},
+  { 0,  2,  4,  8, 10, 12, 14, -1},
+  { 6,  8, 10, 12, 14, -1, -1, -1},
+  { 0,  6,  8, 10, 12, 14, -1, -1},
+  { 2,  6,  8, 10, 12, 14, -1, -1},
+  { 0,  2,  6,  8, 10, 12, 14, -1},
+  { 4,  6,  8, 10, 12, 14, -1, -1},
+  { 0,  4,  6,  8, 10, 12, 14, -1},
+  { 2,  4,  6,  8, 10, 12, 14, -1},
+  { 0,  2,  4,  6,  8, 10, 12, 14}
+};
+
+/*************************************************
+* Name:        rej_uniform_avx2
+*
+* Description: rej_uniform sixteen candidates at a time: 24 input
+*              bytes are spread over the 16-bit lanes of a ymm and
+*              unpacked to 12 bits, compared against q, and the
+*              accepted lanes packed to the front with a shuffle
+*              from rejavx2_idx. The tail, where fewer than 16
+*              outputs or 32 input bytes remain, is the scalar loop.
+*              Needs AVX2 (see genx4_available).
+*
+* Arguments:   - int16_t *r: pointer to output buffer
+*              - unsigned int len: requested number of 16-bit integers
+*                                  (uniform mod q)
+*              - const uint8_t *buf: pointer to input buffer
+*                                    (assumed to be uniformly random bytes)
+*              - unsigned int buflen: length of input buffer in bytes
+*
+* Returns number of sampled 16-bit integers (at most len). The first
+* ones are those of rej_uniform; r[ctr..len) may be overwritten.
+**************************************************/
+REJAVX2_TARGET
+unsigned int rej_uniform_avx2(int16_t *r,
+                              unsigned int len,
+                              const uint8_t *buf,
+                              unsigned int buflen)
+{
+  unsigned int ctr, pos, good;
+  uint16_t val0, val1;
+  const __m256i bound = _mm256_set1_epi16(KYBER_Q);
+  const __m256i mask = _mm256_set1_epi16(0xFFF);
+  const __m256i idx8 = _mm256_set_epi8(15,14,14,13,12,11,11,10,
+                                        9, 8, 8, 7, 6, 5, 5, 4,
+                                       11,10,10, 9, 8, 7, 7, 6,
+                                        5, 4, 4, 3, 2, 1, 1, 0);
+  const __m128i ones = _mm_set1_epi8(1);
+  __m256i f, g;
+  __m128i f0, f1, pi0, pi1;
+
+  ctr = pos = 0;
+  while(ctr + 16 <= len && pos + 32 <= buflen) {
+    f = _mm256_loadu_si256((const __m256i *)&buf[pos]);
+    f = _mm256_permute4x64_epi64(f, 0x94);
+    f = _mm256_shuffle_epi8(f, idx8);
+    g = _mm256_srli_epi16(f, 4);
+    f = _mm256_blend_epi16(f, g, 0xAA);
+    f = _mm256_and_si256(f, mask);
+    pos += 24;
+
+    g = _mm256_cmpgt_epi16(bound, f);
+    g = _mm256_packs_epi16(g, g);
+    good = _mm256_movemask_epi8(g);
+
+    pi0 = _mm_loadl_epi64((const __m128i *)&rejavx2_idx[good & 0xFF]);
+    pi1 = _mm_loadl_epi64((const __m128i *)&rejavx2_idx[(good >> 16) & 0xFF]);
+    pi0 = _mm_unpacklo_epi8(pi0, _mm_add_epi8(pi0, ones));
+    pi1 = _mm_unpacklo_epi8(pi1, _mm_add_epi8(pi1, ones));
+
+    f0 = _mm256_castsi256_si128(f);
+    f1 = _mm256_extracti128_si256(f, 1);
+    f0 = _mm_shuffle_epi8(f0, pi0);
+    f1 = _mm_shuffle_epi8(f1, pi1);
+
+    _mm_storeu_si128((__m128i *)&r[ctr], f0);
+    ctr += _mm_popcnt_u32(good & 0xFF);
+    _mm_storeu_si128((__m128i *)&r[ctr], f1);
+    ctr += _mm_popcnt_u32((good >> 16) & 0xFF);
+  }
+
+  while(ctr < len && pos + 3 <= buflen) {
+    val0 = ((buf[pos+0] >> 0) | ((uint16_t)buf[pos+1] << 8)) & 0xFFF;
+    val1 = ((buf[pos+1] >> 4) | ((uint16_t)buf[pos+2] << 4)) & 0xFFF;
+    pos += 3;
+
+    if(val0 < KYBER_Q)
+      r[ctr++] = val0;
+    if(ctr < len && val1 < KYBER_Q)
+      r[ctr++] = val1;
+  }
+
+  return ctr;
+}
+
+/*************************************************
+* Name:        rej_uniform_fast
+*
+* Description: rej_uniform_avx2 where the CPU has AVX2, the Kyber
+*              ref rej_uniform otherwise
+**************************************************/
+unsigned int rej_uniform_fast(int16_t *r,
+                              unsigned int len,
+                              const uint8_t *buf,
+                              unsigned int buflen)
+{
+  if(genx4_available())
+    return rej_uniform_avx2(r,len,buf,buflen);
+  return rej_uniform(r,len,buf,buflen);
+}
+#else
+unsigned int rej_uniform_fast(int16_t *r,
+                              unsigned int len,
+                              const uint8_t *buf,
+                              unsigned int buflen)
+{
+  return rej_uniform(r,len,buf,buflen);
+}
+#endif
@@ -0,0 +1,26 @@
+#ifndef REJAVX2_H
+#define REJAVX2_H
+
+#include <stdint.h>
+#include "params.h"
+#include "genx4.h"
+
+/*
+  Vectorized rej_uniform for the mask and matrix samplers in genx4.c
+  and aes256ctr.c. The accepted coefficients are those of the Kyber
+  ref rej_uniform, in the same order (test_pake checks this).
+*/
+
+#ifdef GENX4
+unsigned int rej_uniform_avx2(int16_t *r,
+                              unsigned int len,
+                              const uint8_t *buf,
+                              unsigned int buflen);
+#endif
+
+unsigned int rej_uniform_fast(int16_t *r,
+                              unsigned int len,
+                              const uint8_t *buf,
+                              unsigned int buflen);
+
+#endif
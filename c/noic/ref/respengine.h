@@ -0,0 +1,62 @@
+#ifndef RESPENGINE_H
+#define RESPENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "params.h"
+#include "pake.h"
+
+/*
+  Responder engine: a pool of worker threads answering msg1s with
+  resp, or with resp_batch on up to batch jobs at a time. Each worker
+  has its own deque of pending jobs. Submissions are spread over the
+  deques round robin; a worker takes the oldest job of its own deque
+  and, when that is empty, steals the newest ones of the others. Idle
+  workers sleep on a condition variable.
+
+  Jobs are owned by the caller and must stay valid until their done
+  callback has run; the callback runs on the worker thread, after
+  key and msg2 have been written. At most max_pending jobs are
+  accepted and not yet completed; respengine_submit refuses more
+  (back-pressure) instead of queueing without bound.
+*/
+
+typedef struct respengine respengine;
+
+typedef struct respengine_job respengine_job;
+
+struct respengine_job {
+  uint8_t msg1[MSG1_LEN];                   // in
+  uint8_t pw[KYBER_SYMBYTES];               // in
+  uint8_t sid[KYBER_SYMBYTES];              // in
+  uint8_t key[KYBER_SYMBYTES];              // out
+  uint8_t msg2[MSG2_LEN];                   // out
+  void (*done)(respengine_job *job);        // completion callback
+  void *arg;                                // for the callback
+};
+
+/* starts nthreads workers (0: one per online CPU), pinned to CPU
+   i mod #CPUs if pin is set; batch is clamped to 1..PAKE_BATCH.
+   Returns NULL on failure. */
+respengine *respengine_new(unsigned int nthreads, size_t max_pending,
+                           unsigned int batch, int pin);
+
+/* waits for all accepted jobs, stops the workers and frees the
+   engine */
+void respengine_free(respengine *e);
+
+/* queues job: 0 if accepted, -1 if max_pending jobs are in flight */
+int respengine_submit(respengine *e, respengine_job *job);
+
+/* waits until every accepted job has completed */
+void respengine_drain(respengine *e);
+
+/* number of worker threads */
+unsigned int respengine_threads(const respengine *e);
+
+/* jobs completed, refused by respengine_submit, and stolen from
+   another worker's deque so far */
+void respengine_stats(respengine *e, uint64_t *completed,
+                      uint64_t *rejected, uint64_t *stolen);
+
+#endif
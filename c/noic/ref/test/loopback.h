@@ -0,0 +1,66 @@
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include "../pake.h"
+#include "fips202.h"
+
+/*
+  Framing shared by the loopback server (pake_server.c) and client
+  (pake_client.c). Every frame is a 4-byte big-endian payload length
+  followed by the payload:
+    client -> server: sid || msg1
+    server -> client: msg2, or msg2 || SHA3-256(key) when the server
+                      runs with key confirmation (-c)
+  A connection carries any number of handshakes, one at a time. Both
+  sides use the same fixed benchmark password.
+*/
+
+#define LOOPBACK_PORT 7350
+#define LOOPBACK_HDR 4
+#define LOOPBACK_REQ (KYBER_SYMBYTES+MSG1_LEN)
+#define LOOPBACK_RSP (MSG2_LEN)
+#define LOOPBACK_RSP_TAG (MSG2_LEN+KYBER_SYMBYTES)
+
+static inline void loopback_password(uint8_t pw[KYBER_SYMBYTES])
+{
+  static const char label[] = "pake loopback benchmark password";
+
+  sha3_256(pw,(const uint8_t *)label,sizeof(label)-1);
+}
+
+static inline void loopback_put32(uint8_t b[4], uint32_t x)
+{
+  b[0] = (uint8_t)(x >> 24);
+  b[1] = (uint8_t)(x >> 16);
+  b[2] = (uint8_t)(x >> 8);
+  b[3] = (uint8_t)x;
+}
+
+static inline uint32_t loopback_get32(const uint8_t b[4])
+{
+  return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+}
+
+static inline int loopback_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+
+  return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// user plus system CPU time of the process, in seconds
+static inline double loopback_cpu(void)
+{
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+       + 1e-6*(double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+#endif
@@ -0,0 +1,12 @@
+# loopback handshake benchmark: pake_server and pake_client over
+# 127.0.0.1, for each K; run from the test directory after make speed
+PORT=${PORT:-7350}
+CONNS=${CONNS:-64}
+HANDSHAKES=${HANDSHAKES:-20000}
+for K in 512 768 1024
+do
+  ./pake_server$K -c $PORT $HANDSHAKES &
+  sleep 0.5
+  ./pake_client$K $PORT $CONNS $HANDSHAKES || kill $!
+  wait $!
+done
@@ -0,0 +1,285 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "../pake.h"
+#include "kem.h"
+#include "randombytes.h"
+#include "loopback.h"
+
+/*
+  Loopback PAKE initiator: keeps many connections to pake_server busy,
+  each running initStart / send / receive / initEnd back to back until
+  the requested number of handshakes has completed.
+
+  usage: pake_client [port] [connections] [handshakes]
+
+  Prints handshakes/s, the client CPU time per handshake and the
+  p50/p99/p99.9 handshake latency (initStart to initEnd, queueing
+  included). Fails if an initEnd fails or, when the server runs with
+  -c, if a key differs from the server's.
+*/
+
+#define MAXEVENTS 64
+
+typedef struct {
+  int fd;
+  int connected;
+  uint8_t out[LOOPBACK_HDR+LOOPBACK_REQ];      // header || sid || msg1
+  size_t outpos;
+  uint8_t in[LOOPBACK_HDR+LOOPBACK_RSP_TAG];
+  size_t inlen;
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  struct timespec t0;
+} conn;
+
+static double elapsed(const struct timespec *a, const struct timespec *b)
+{
+  return (double)(b->tv_sec - a->tv_sec) + 1e-9*(double)(b->tv_nsec - a->tv_nsec);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void conn_events(int ep, conn *c, uint32_t events)
+{
+  struct epoll_event ev;
+
+  ev.events = events;
+  ev.data.ptr = c;
+  epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// sends what it can of the request; 1 when done, 0 on EAGAIN, -1 on error
+static int conn_flush(conn *c)
+{
+  ssize_t r;
+
+  while(c->outpos < sizeof(c->out)) {
+    r = send(c->fd, c->out+c->outpos, sizeof(c->out)-c->outpos, MSG_NOSIGNAL);
+    if(r < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    c->outpos += (size_t)r;
+  }
+  return 1;
+}
+
+// starts a handshake on c and sends msg1
+static int conn_start(int ep, conn *c, const uint8_t pw[KYBER_SYMBYTES])
+{
+  uint8_t *sid = c->out+LOOPBACK_HDR;
+  int r;
+
+  clock_gettime(CLOCK_MONOTONIC, &c->t0);
+  randombytes(sid,KYBER_SYMBYTES);
+  initStart(sid+KYBER_SYMBYTES,c->pk,c->sk,pw,sid);
+  loopback_put32(c->out,LOOPBACK_REQ);
+  c->outpos = 0;
+  c->inlen = 0;
+
+  r = conn_flush(c);
+  if(r >= 0)
+    conn_events(ep, c, r ? EPOLLIN : EPOLLOUT);
+  return r;
+}
+
+// reads msg2 and finishes the handshake: 1 when done, 0 on EAGAIN, -1 on error
+static int conn_finish(conn *c, int *confirmed)
+{
+  uint8_t key[KYBER_SYMBYTES], tag[KYBER_SYMBYTES];
+  const uint8_t *sid = c->out+LOOPBACK_HDR;
+  uint32_t len = 0;
+  size_t want;
+  ssize_t got;
+
+  for(;;) {
+    if(c->inlen >= LOOPBACK_HDR) {
+      len = loopback_get32(c->in);
+      if(len != LOOPBACK_RSP && len != LOOPBACK_RSP_TAG) {
+        fprintf(stderr, "bad frame length %u\n", (unsigned int)len);
+        return -1;
+      }
+      want = LOOPBACK_HDR+len;
+      if(c->inlen == want)
+        break;
+    } else {
+      want = LOOPBACK_HDR;
+    }
+    got = recv(c->fd, c->in+c->inlen, want-c->inlen, 0);
+    if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return 0;
+    if(got <= 0)
+      return -1;
+    c->inlen += (size_t)got;
+  }
+
+  if(initEnd(key,c->in+LOOPBACK_HDR,sid+KYBER_SYMBYTES,c->pk,c->sk,sid)) {
+    fprintf(stderr, "initEnd failed\n");
+    return -1;
+  }
+  if(len == LOOPBACK_RSP_TAG) {
+    sha3_256(tag,key,KYBER_SYMBYTES);
+    if(memcmp(tag,c->in+LOOPBACK_HDR+MSG2_LEN,KYBER_SYMBYTES)) {
+      fprintf(stderr, "key mismatch\n");
+      return -1;
+    }
+    *confirmed = 1;
+  }
+  memset(key,0,sizeof(key));
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  struct epoll_event ev, events[MAXEVENTS];
+  struct timespec start, stop, now;
+  uint8_t pw[KYBER_SYMBYTES];
+  unsigned long nconns = 64, total = 10000, started = 0, completed = 0, active;
+  double *lat, cpu0, secs;
+  int port = LOOPBACK_PORT, one = 1, confirmed = 0, err = 0;
+  int ep, n, i, r;
+  socklen_t errlen;
+  unsigned long j;
+  conn *conns, *c;
+
+  if(argc > 1)
+    port = atoi(argv[1]);
+  if(argc > 2)
+    nconns = strtoul(argv[2],NULL,10);
+  if(argc > 3)
+    total = strtoul(argv[3],NULL,10);
+  if(nconns == 0)
+    nconns = 1;
+  if(nconns > total)
+    nconns = total;
+
+  loopback_password(pw);
+  conns = calloc(nconns, sizeof(conn));
+  lat = malloc(total*sizeof(double));
+  if(conns == NULL || lat == NULL)
+    return 1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  ep = epoll_create1(0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  cpu0 = loopback_cpu();
+
+  for(j=0;j<nconns;j++) {
+    c = &conns[j];
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(c->fd < 0 || loopback_nonblocking(c->fd)) {
+      perror("socket");
+      return 1;
+    }
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if(connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) && errno != EINPROGRESS) {
+      perror("connect");
+      return 1;
+    }
+    // writable once connected
+    ev.events = EPOLLOUT;
+    ev.data.ptr = c;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+  }
+  active = nconns;
+
+  while(completed < total && active > 0) {
+    n = epoll_wait(ep, events, MAXEVENTS, 10000);
+    if(n == 0) {
+      fprintf(stderr, "timeout, %lu of %lu handshakes done\n", completed, total);
+      err = 1;
+      break;
+    }
+    if(n < 0) {
+      if(errno == EINTR)
+        continue;
+      perror("epoll_wait");
+      err = 1;
+      break;
+    }
+
+    for(i=0;i<n;i++) {
+      c = events[i].data.ptr;
+      r = 1;
+
+      if(!c->connected) {
+        errlen = sizeof(r);
+        if(getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &r, &errlen) || r) {
+          fprintf(stderr, "connect: %s\n", strerror(r));
+          r = -1;
+        } else {
+          c->connected = 1;
+          started++;
+          r = conn_start(ep, c, pw);
+        }
+      } else if(events[i].events & EPOLLOUT) {
+        r = conn_flush(c);
+        if(r > 0)
+          conn_events(ep, c, EPOLLIN);
+      } else {
+        r = conn_finish(c, &confirmed);
+        if(r > 0) {
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          lat[completed++] = elapsed(&c->t0, &now);
+          if(started < total) {
+            started++;
+            r = conn_start(ep, c, pw);
+          } else {
+            r = -2;
+          }
+        }
+      }
+
+      if(r < 0) {
+        if(r == -1)
+          err = 1;
+        epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+        active--;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  cpu0 = loopback_cpu()-cpu0;
+
+  for(j=0;j<nconns;j++)
+    if(conns[j].fd >= 0)
+      close(conns[j].fd);
+  close(ep);
+
+  if(err || completed < total) {
+    printf("ERROR client: %lu of %lu handshakes completed\n", completed, total);
+    return 1;
+  }
+
+  secs = elapsed(&start, &stop);
+  qsort(lat, total, sizeof(double), cmp_double);
+  printf("client: %lu handshakes over %lu connections, %.0f handshakes/s, %.1f us CPU/handshake\n",
+         total, nconns, total/secs, 1e6*cpu0/total);
+  printf("latency: p50 %.1f us  p99 %.1f us  p99.9 %.1f us%s\n",
+         1e6*lat[total/2], 1e6*lat[total*99/100], 1e6*lat[total*999/1000],
+         confirmed ? "  (keys confirmed)" : "");
+  free(conns);
+  free(lat);
+  return 0;
+}
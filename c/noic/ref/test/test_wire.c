@@ -0,0 +1,127 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "../pake.h"
+#include "../sha3inc.h"
+#include "fips202.h"
+#include "kem.h"
+#include "randombytes.h"
+
+#define NRUNS 32
+
+/*
+  Runs NRUNS handshakes on a fixed randombytes stream and prints a
+  digest of every msg1, msg2 and key, so that builds against
+  different Kyber backends can be checked for identical wire
+  messages. Then checks the batched
+  responder and initiator end byte for byte against the single ones.
+*/
+
+static uint64_t drbg_ctr;
+
+void randombytes(uint8_t *out, size_t outlen)
+{
+  uint8_t in[8];
+  unsigned int i;
+
+  for(i=0;i<8;i++)
+    in[i] = drbg_ctr >> 8*i;
+  drbg_ctr++;
+  shake256(out,outlen,in,8);
+}
+
+#define NBATCHRUNS (PAKE_BATCH+3)
+
+/*
+  resp_batch and initEnd_batch against resp and initEnd on the same
+  randombytes stream: all initStart calls come first, so that both
+  responders draw the encapsulation coins in the same order.
+*/
+static int test_batch(void)
+{
+  static uint8_t sid[NBATCHRUNS][CRYPTO_BYTES];
+  static uint8_t pw[NBATCHRUNS][CRYPTO_BYTES];
+  static uint8_t sk[NBATCHRUNS][CRYPTO_SECRETKEYBYTES];
+  static uint8_t pk[NBATCHRUNS][CRYPTO_PUBLICKEYBYTES];
+  static uint8_t key_a[NBATCHRUNS][CRYPTO_BYTES];
+  static uint8_t key_b[NBATCHRUNS][CRYPTO_BYTES];
+  static uint8_t key_c[NBATCHRUNS][CRYPTO_BYTES];
+  static uint8_t msg1[NBATCHRUNS][MSG1_LEN];
+  static uint8_t msg2_a[NBATCHRUNS][MSG2_LEN];
+  static uint8_t msg2_b[NBATCHRUNS][MSG2_LEN];
+  int result[NBATCHRUNS];
+  uint64_t ctr;
+  unsigned int i;
+
+  for(i=0;i<NBATCHRUNS;i++) {
+    randombytes(pw[i],CRYPTO_BYTES);
+    randombytes(sid[i],CRYPTO_BYTES);
+    initStart(msg1[i],pk[i],sk[i],pw[i],sid[i]);
+  }
+
+  ctr = drbg_ctr;
+  for(i=0;i<NBATCHRUNS;i++)
+    resp(key_a[i],msg2_a[i],msg1[i],pw[i],sid[i]);
+  drbg_ctr = ctr;
+  resp_batch(key_b,msg2_b,(const uint8_t (*)[MSG1_LEN])msg1,
+             (const uint8_t (*)[CRYPTO_BYTES])pw,
+             (const uint8_t (*)[CRYPTO_BYTES])sid,NBATCHRUNS);
+  if(memcmp(key_a,key_b,sizeof(key_a)) || memcmp(msg2_a,msg2_b,sizeof(msg2_a))) {
+    printf("ERROR resp_batch\n");
+    return 1;
+  }
+
+  if(initEnd_batch(key_c,result,(const uint8_t (*)[MSG2_LEN])msg2_b,
+                   (const uint8_t (*)[MSG1_LEN])msg1,
+                   (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])pk,
+                   (const uint8_t (*)[CRYPTO_SECRETKEYBYTES])sk,
+                   (const uint8_t (*)[CRYPTO_BYTES])sid,NBATCHRUNS) ||
+     memcmp(key_a,key_c,sizeof(key_a))) {
+    printf("ERROR initEnd_batch\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+int main(void)
+{
+  unsigned int i;
+  uint8_t sid[CRYPTO_BYTES];
+  uint8_t pw[CRYPTO_BYTES];
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t key_a[CRYPTO_BYTES];
+  uint8_t key_b[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+  uint8_t h[32];
+  keccak_state state;
+
+  sha3_256_inc_init(&state);
+  for(i=0;i<NRUNS;i++) {
+    randombytes(pw,CRYPTO_BYTES);
+    randombytes(sid,CRYPTO_BYTES);
+
+    initStart(msg1,pk,sk,pw,sid);
+    resp(key_b,msg2,msg1,pw,sid);
+    initEnd(key_a,msg2,msg1,pk,sk,sid);
+
+    if(memcmp(key_a,key_b,CRYPTO_BYTES)) {
+      printf("ERROR keys\n");
+      return 1;
+    }
+
+    sha3_256_inc_absorb(&state,msg1,MSG1_LEN);
+    sha3_256_inc_absorb(&state,msg2,MSG2_LEN);
+    sha3_256_inc_absorb(&state,key_a,CRYPTO_BYTES);
+  }
+  sha3_256_inc_finalize(h,&state);
+
+  for(i=0;i<32;i++)
+    printf("%02x",h[i]);
+  printf("\n");
+
+  return test_batch();
+}
@@ -0,0 +1,50 @@
+#ifndef TURBOSHAKE_H
+#define TURBOSHAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fips202.h"
+
+/*
+  TurboSHAKE128/256 (RFC 9861): the SHAKE sponges on the 12-round
+  Keccak-p[1600,12] of keccakf1600.c, with a domain separation byte
+  ds in 0x01..0x7F in place of the SHAKE padding. The state type is
+  the Kyber keccak_state; call init, absorb any number of times,
+  finalize with ds, then squeeze.
+
+  With PAKE_TURBOSHAKE the password-masking hashes and the
+  gen_vector streams use these under the domain bytes below; the
+  KEM keeps its own hashes.
+*/
+
+#define TURBOSHAKE_NROUNDS 12
+#define TURBOSHAKE128_RATE 168
+#define TURBOSHAKE256_RATE 136
+
+// gen_vector streams, seed||i||0xFF as for SHAKE-128
+#define TURBOSHAKE_DS_XOF 0x0B
+// masking hashes with 32 bytes of output (in place of hash_h)
+#define TURBOSHAKE_DS_HASH_H 0x0C
+// masking hashes with 64 bytes of output (in place of hash_g)
+#define TURBOSHAKE_DS_HASH_G 0x0D
+
+void turboshake128_init(keccak_state *state);
+void turboshake128_absorb(keccak_state *state, const uint8_t *in, size_t inlen);
+void turboshake128_finalize(keccak_state *state, uint8_t ds);
+void turboshake128_squeeze(uint8_t *out, size_t outlen, keccak_state *state);
+void turboshake128_squeezeblocks(uint8_t *out, size_t nblocks, keccak_state *state);
+
+void turboshake256_init(keccak_state *state);
+void turboshake256_absorb(keccak_state *state, const uint8_t *in, size_t inlen);
+void turboshake256_finalize(keccak_state *state, uint8_t ds);
+void turboshake256_squeeze(uint8_t *out, size_t outlen, keccak_state *state);
+
+// finalize and squeeze outlen bytes
+void turboshake256_final(uint8_t *out, size_t outlen, keccak_state *state, uint8_t ds);
+
+void turboshake128(uint8_t *out, size_t outlen,
+                   const uint8_t *in, size_t inlen, uint8_t ds);
+void turboshake256(uint8_t *out, size_t outlen,
+                   const uint8_t *in, size_t inlen, uint8_t ds);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef TWOFEISTEL_H
 #define TWOFEISTEL_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "params.h"
 #include "polyvec.h"
@@ -21,4 +22,26 @@ void twofeistel_inv(uint8_t pk[KYBER_PUBLICKEYBYTES],
              const uint8_t pw[KYBER_SYMBYTES],
              const uint8_t sid[KYBER_SYMBYTES]);
 
+// twofeistel_inv that also hands out the unmasked vector part of pk
+// unpacked, for kem_enc_unpacked
+void twofeistel_inv_unpacked(uint8_t pk[KYBER_PUBLICKEYBYTES],
+                             polyvec *pkpv,
+                             const uint8_t twofc[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES],
+                             const uint8_t pw[KYBER_SYMBYTES],
+                             const uint8_t sid[KYBER_SYMBYTES]);
+
+/*
+  Batched twofeistel_inv_unpacked: n independent inversions, the
+  nonce-mask hashes over the vector parts four at a time on the x4
+  Keccak (genx4.h), TWOFEISTEL_BATCH per chunk.
+*/
+#define TWOFEISTEL_BATCH 8
+
+void twofeistel_inv_unpacked_xN(uint8_t (*pk)[KYBER_PUBLICKEYBYTES],
+                                polyvec *pkpv,
+                                const uint8_t (*twofc)[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES],
+                                const uint8_t (*pw)[KYBER_SYMBYTES],
+                                const uint8_t (*sid)[KYBER_SYMBYTES],
+                                size_t n);
+
 #endif
@@ -0,0 +1,606 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "params.h"
+#include "genx4.h"
+#include "indcpa.h"
+#include "polyvec.h"
+#include "rejavx2.h"
+#include "rej_uniform.h"
+#include "symmetric.h"
+#include "keccakf1600.h"
+#include "turboshake.h"
+
+// same sizing as GEN_MATRIX_NBLOCKS in the Kyber ref
+#define GEN_POLY_NBLOCKS ((12*KYBER_N/8*(1 << 12)/KYBER_Q + XOF_BLOCKBYTES)/XOF_BLOCKBYTES)
+
+#ifdef GENX4
+
+#include <stdatomic.h>
+#include <immintrin.h>
+
+#define GENX4_TARGET __attribute__((target("avx2")))
+
+#define NROUNDS 24
+#define GENX4_SHAKE_DS 0x1F
+#define SHAKE128_RATE 168
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ROL(a, offset) _mm256_or_si256(_mm256_slli_epi64(a, offset), \
+                                       _mm256_srli_epi64(a, 64-(offset)))
+
+// same sizing as GEN_MATRIX_NBLOCKS in the Kyber ref
+#define GENX4_NBLOCKS ((12*KYBER_N/8*(1 << 12)/KYBER_Q + SHAKE128_RATE)/SHAKE128_RATE)
+
+static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
+  0x0000000000000001ULL, 0x0000000000008082ULL,
+  0x800000000000808aULL, 0x8000000080008000ULL,
+  0x000000000000808bULL, 0x0000000080000001ULL,
+  0x8000000080008081ULL, 0x8000000000008009ULL,
+  0x000000000000008aULL, 0x0000000000000088ULL,
+  0x0000000080008009ULL, 0x000000008000000aULL,
+  0x000000008000808bULL, 0x800000000000008bULL,
+  0x8000000000008089ULL, 0x8000000000008003ULL,
+  0x8000000000008002ULL, 0x8000000000000080ULL,
+  0x000000000000800aULL, 0x800000008000000aULL,
+  0x8000000080008081ULL, 0x8000000000008080ULL,
+  0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+static atomic_int genx4_cpu = -1;
+
+int genx4_available(void)
+{
+  // cached for all threads: racing first calls store the same
+  // value, relaxed atomics keep that well-defined
+  int cpu = atomic_load_explicit(&genx4_cpu, memory_order_relaxed);
+
+  if(cpu < 0) {
+    __builtin_cpu_init();
+    cpu = __builtin_cpu_supports("avx2") != 0;
+    atomic_store_explicit(&genx4_cpu, cpu, memory_order_relaxed);
+  }
+  return cpu;
+}
+
+/*************************************************
+* Name:        KeccakP1600x4_StatePermute
+*
+* Description: The last nrounds rounds of Keccak-f[1600] on four states
+*              at once: 24 for SHAKE, 12 for TurboSHAKE; lane j of
+*              state l is 64-bit element l of state[j]
+**************************************************/
+GENX4_TARGET
+static void KeccakP1600x4_StatePermute(__m256i state[25], unsigned int nrounds)
+{
+  unsigned int round;
+  const __m256i rho8 = _mm256_set_epi8(14,13,12,11,10,9,8,15,6,5,4,3,2,1,0,7,
+                                       14,13,12,11,10,9,8,15,6,5,4,3,2,1,0,7);
+  const __m256i rho56 = _mm256_set_epi8(8,15,14,13,12,11,10,9,0,7,6,5,4,3,2,1,
+                                        8,15,14,13,12,11,10,9,0,7,6,5,4,3,2,1);
+  __m256i Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki,
+          Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+  __m256i Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+  __m256i Bba, Bbe, Bbi, Bbo, Bbu, Bga, Bge, Bgi, Bgo, Bgu, Bka, Bke, Bki,
+          Bko, Bku, Bma, Bme, Bmi, Bmo, Bmu, Bsa, Bse, Bsi, Bso, Bsu;
+
+  Aba = state[0];
+  Abe = state[1];
+  Abi = state[2];
+  Abo = state[3];
+  Abu = state[4];
+  Aga = state[5];
+  Age = state[6];
+  Agi = state[7];
+  Ago = state[8];
+  Agu = state[9];
+  Aka = state[10];
+  Ake = state[11];
+  Aki = state[12];
+  Ako = state[13];
+  Aku = state[14];
+  Ama = state[15];
+  Ame = state[16];
+  Ami = state[17];
+  Amo = state[18];
+  Amu = state[19];
+  Asa = state[20];
+  Ase = state[21];
+  Asi = state[22];
+  Aso = state[23];
+  Asu = state[24];
+
+  for(round=NROUNDS-nrounds;round<NROUNDS;round++) {
+    // theta
+    Ca = XOR(XOR(XOR(XOR(Aba, Aga), Aka), Ama), Asa);
+    Ce = XOR(XOR(XOR(XOR(Abe, Age), Ake), Ame), Ase);
+    Ci = XOR(XOR(XOR(XOR(Abi, Agi), Aki), Ami), Asi);
+    Co = XOR(XOR(XOR(XOR(Abo, Ago), Ako), Amo), Aso);
+    Cu = XOR(XOR(XOR(XOR(Abu, Agu), Aku), Amu), Asu);
+    Da = XOR(Cu, ROL(Ce, 1));
+    De = XOR(Ca, ROL(Ci, 1));
+    Di = XOR(Ce, ROL(Co, 1));
+    Do = XOR(Ci, ROL(Cu, 1));
+    Du = XOR(Co, ROL(Ca, 1));
+
+    // rho and pi
+    Bba = XOR(Aba, Da);
+    Bka = ROL(XOR(Abe, De), 1);
+    Bsa = ROL(XOR(Abi, Di), 62);
+    Bga = ROL(XOR(Abo, Do), 28);
+    Bma = ROL(XOR(Abu, Du), 27);
+    Bme = ROL(XOR(Aga, Da), 36);
+    Bbe = ROL(XOR(Age, De), 44);
+    Bke = ROL(XOR(Agi, Di), 6);
+    Bse = ROL(XOR(Ago, Do), 55);
+    Bge = ROL(XOR(Agu, Du), 20);
+    Bgi = ROL(XOR(Aka, Da), 3);
+    Bmi = ROL(XOR(Ake, De), 10);
+    Bbi = ROL(XOR(Aki, Di), 43);
+    Bki = ROL(XOR(Ako, Do), 25);
+    Bsi = ROL(XOR(Aku, Du), 39);
+    Bso = ROL(XOR(Ama, Da), 41);
+    Bgo = ROL(XOR(Ame, De), 45);
+    Bmo = ROL(XOR(Ami, Di), 15);
+    Bbo = ROL(XOR(Amo, Do), 21);
+    Bko = _mm256_shuffle_epi8(XOR(Amu, Du), rho8);
+    Bku = ROL(XOR(Asa, Da), 18);
+    Bsu = ROL(XOR(Ase, De), 2);
+    Bgu = ROL(XOR(Asi, Di), 61);
+    Bmu = _mm256_shuffle_epi8(XOR(Aso, Do), rho56);
+    Bbu = ROL(XOR(Asu, Du), 14);
+
+    // chi
+    Aba = XOR(Bba, _mm256_andnot_si256(Bbe, Bbi));
+    Abe = XOR(Bbe, _mm256_andnot_si256(Bbi, Bbo));
+    Abi = XOR(Bbi, _mm256_andnot_si256(Bbo, Bbu));
+    Abo = XOR(Bbo, _mm256_andnot_si256(Bbu, Bba));
+    Abu = XOR(Bbu, _mm256_andnot_si256(Bba, Bbe));
+    Aga = XOR(Bga, _mm256_andnot_si256(Bge, Bgi));
+    Age = XOR(Bge, _mm256_andnot_si256(Bgi, Bgo));
+    Agi = XOR(Bgi, _mm256_andnot_si256(Bgo, Bgu));
+    Ago = XOR(Bgo, _mm256_andnot_si256(Bgu, Bga));
+    Agu = XOR(Bgu, _mm256_andnot_si256(Bga, Bge));
+    Aka = XOR(Bka, _mm256_andnot_si256(Bke, Bki));
+    Ake = XOR(Bke, _mm256_andnot_si256(Bki, Bko));
+    Aki = XOR(Bki, _mm256_andnot_si256(Bko, Bku));
+    Ako = XOR(Bko, _mm256_andnot_si256(Bku, Bka));
+    Aku = XOR(Bku, _mm256_andnot_si256(Bka, Bke));
+    Ama = XOR(Bma, _mm256_andnot_si256(Bme, Bmi));
+    Ame = XOR(Bme, _mm256_andnot_si256(Bmi, Bmo));
+    Ami = XOR(Bmi, _mm256_andnot_si256(Bmo, Bmu));
+    Amo = XOR(Bmo, _mm256_andnot_si256(Bmu, Bma));
+    Amu = XOR(Bmu, _mm256_andnot_si256(Bma, Bme));
+    Asa = XOR(Bsa, _mm256_andnot_si256(Bse, Bsi));
+    Ase = XOR(Bse, _mm256_andnot_si256(Bsi, Bso));
+    Asi = XOR(Bsi, _mm256_andnot_si256(Bso, Bsu));
+    Aso = XOR(Bso, _mm256_andnot_si256(Bsu, Bsa));
+    Asu = XOR(Bsu, _mm256_andnot_si256(Bsa, Bse));
+
+    // iota
+    Aba = XOR(Aba, _mm256_set1_epi64x((long long)KeccakF_RoundConstants[round]));
+  }
+
+  state[0] = Aba;
+  state[1] = Abe;
+  state[2] = Abi;
+  state[3] = Abo;
+  state[4] = Abu;
+  state[5] = Aga;
+  state[6] = Age;
+  state[7] = Agi;
+  state[8] = Ago;
+  state[9] = Agu;
+  state[10] = Aka;
+  state[11] = Ake;
+  state[12] = Aki;
+  state[13] = Ako;
+  state[14] = Aku;
+  state[15] = Ama;
+  state[16] = Ame;
+  state[17] = Ami;
+  state[18] = Amo;
+  state[19] = Amu;
+  state[20] = Asa;
+  state[21] = Ase;
+  state[22] = Asi;
+  state[23] = Aso;
+  state[24] = Asu;
+}
+
+
+/*************************************************
+* Name:        shake128x4_absorb34
+*
+* Description: Absorbs seed||x[l]||y[l] into state lane l and pads
+*              with ds, as kyber_shake128_absorb does for one state
+*              with ds = 0x1F; TurboSHAKE128 takes its domain byte
+*              at the same place
+**************************************************/
+GENX4_TARGET
+static void shake128x4_absorb34(__m256i state[25],
+                                const uint8_t seed[KYBER_SYMBYTES],
+                                const uint8_t x[4],
+                                const uint8_t y[4],
+                                uint8_t ds)
+{
+  unsigned int i;
+  uint64_t s[4];
+
+  for(i=0;i<KYBER_SYMBYTES/8;i++) {
+    memcpy(&s[0],seed+8*i,8);
+    state[i] = _mm256_set1_epi64x((long long)s[0]);
+  }
+  for(i=0;i<4;i++)
+    s[i] = (uint64_t)x[i] | (uint64_t)y[i] << 8 | (uint64_t)ds << 16;
+  state[KYBER_SYMBYTES/8] = _mm256_set_epi64x((long long)s[3],(long long)s[2],
+                                              (long long)s[1],(long long)s[0]);
+  for(i=KYBER_SYMBYTES/8+1;i<25;i++)
+    state[i] = _mm256_setzero_si256();
+  state[SHAKE128_RATE/8-1] = _mm256_set1_epi64x((long long)(1ULL << 63));
+}
+
+/*************************************************
+* Name:        shake128x4_squeezeblocks
+*
+* Description: Squeezes nblocks SHAKE-128 blocks out of each state
+*              lane into out[lane], nrounds as for
+*              KeccakP1600x4_StatePermute
+**************************************************/
+GENX4_TARGET
+static void shake128x4_squeezeblocks(uint8_t *out[4], size_t nblocks,
+                                     __m256i state[25],
+                                     unsigned int nrounds)
+{
+  unsigned int i, l;
+  uint64_t t[4] __attribute__((aligned(32)));
+
+  while(nblocks > 0) {
+    KeccakP1600x4_StatePermute(state,nrounds);
+    for(i=0;i<SHAKE128_RATE/8;i++) {
+      _mm256_store_si256((__m256i *)t,state[i]);
+      for(l=0;l<4;l++)
+        memcpy(out[l]+8*i,&t[l],8);
+    }
+    for(l=0;l<4;l++)
+      out[l] += SHAKE128_RATE;
+    nblocks--;
+  }
+}
+
+/*************************************************
+* Name:        gen_x4
+*
+* Description: Fills n <= 4 polynomials with rejection-sampled
+*              SHAKE-128(seed||x[l]||y[l]) output, exactly as the
+*              Kyber ref gen_matrix does one at a time; with
+*              ds = TURBOSHAKE_DS_XOF and nrounds = 12 the streams
+*              are TurboSHAKE128 ones
+**************************************************/
+GENX4_TARGET
+static void gen_x4(poly *r[4], unsigned int n,
+                   const uint8_t seed[KYBER_SYMBYTES],
+                   const uint8_t x[4],
+                   const uint8_t y[4],
+                   uint8_t ds,
+                   unsigned int nrounds)
+{
+  unsigned int l, k, off, todo;
+  unsigned int ctr[4], buflen[4];
+  uint8_t buf[4][GENX4_NBLOCKS*SHAKE128_RATE+2];
+  uint8_t *out[4];
+  __m256i state[25];
+
+  shake128x4_absorb34(state,seed,x,y,ds);
+  for(l=0;l<4;l++)
+    out[l] = buf[l];
+  shake128x4_squeezeblocks(out,GENX4_NBLOCKS,state,nrounds);
+
+  todo = 0;
+  for(l=0;l<n;l++) {
+    buflen[l] = GENX4_NBLOCKS*SHAKE128_RATE;
+    ctr[l] = rej_uniform_avx2(r[l]->coeffs,KYBER_N,buf[l],buflen[l]);
+    todo |= ctr[l] < KYBER_N;
+  }
+
+  // rare: squeeze one more block on all lanes until every poly is full
+  while(todo) {
+    for(l=0;l<4;l++) {
+      off = l < n ? buflen[l] % 3 : 0;
+      for(k=0;k<off;k++)
+        buf[l][k] = buf[l][buflen[l]-off+k];
+      out[l] = buf[l]+off;
+    }
+    shake128x4_squeezeblocks(out,1,state,nrounds);
+    todo = 0;
+    for(l=0;l<n;l++) {
+      if(ctr[l] < KYBER_N) {
+        off = buflen[l] % 3;
+        buflen[l] = off + SHAKE128_RATE;
+        ctr[l] += rej_uniform_avx2(r[l]->coeffs+ctr[l],KYBER_N-ctr[l],buf[l],buflen[l]);
+        todo |= ctr[l] < KYBER_N;
+      }
+    }
+  }
+}
+
+/*************************************************
+* Name:        keccakx4_permute_avx2
+*
+* Description: KeccakP1600x4_StatePermute on the interleaved lanes
+*              of a keccakx4_state
+**************************************************/
+GENX4_TARGET
+static void keccakx4_permute_avx2(uint64_t s[4*25], unsigned int nrounds)
+{
+  unsigned int i;
+  __m256i state[25];
+
+  for(i=0;i<25;i++)
+    state[i] = _mm256_load_si256((const __m256i *)&s[4*i]);
+  KeccakP1600x4_StatePermute(state,nrounds);
+  for(i=0;i<25;i++)
+    _mm256_store_si256((__m256i *)&s[4*i],state[i]);
+}
+#else
+int genx4_available(void)
+{
+  return 0;
+}
+#endif
+
+/*************************************************
+* Name:        gen_vector_x4
+*
+* Description: gen_vector, four polynomials at a time
+*
+* Arguments:   - polyvec *a: pointer to output vector
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+**************************************************/
+void gen_vector_x4(polyvec *a, const uint8_t seed[KYBER_SYMBYTES])
+{
+#ifdef GENX4
+  unsigned int i, l, n;
+  uint8_t x[4], y[4];
+  poly *r[4];
+
+  if(genx4_available()) {
+    for(i=0;i<KYBER_K;i+=n) {
+      n = KYBER_K-i < 4 ? KYBER_K-i : 4;
+      for(l=0;l<4;l++) {
+        // lanes past n are squeezed but not used
+        r[l] = &a->vec[i + (l < n ? l : 0)];
+        x[l] = i+l;
+        y[l] = GENX4_VECTOR_Y;
+      }
+      gen_x4(r,n,seed,x,y,GENX4_SHAKE_DS,NROUNDS);
+    }
+    return;
+  }
+#endif
+  gen_vector(a,seed);
+}
+
+/*************************************************
+* Name:        gen_vector_poly_turboshake
+*
+* Description: Polynomial i of gen_vector_turboshake on its own,
+*              rejection-sampled from
+*              TurboSHAKE128(seed||i||0xFF, TURBOSHAKE_DS_XOF)
+*
+* Arguments:   - poly *r: pointer to output polynomial
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+*              - unsigned int i: index of the polynomial
+**************************************************/
+void gen_vector_poly_turboshake(poly *r, const uint8_t seed[KYBER_SYMBYTES], unsigned int i)
+{
+  unsigned int ctr, k, buflen, off;
+  uint8_t buf[GEN_POLY_NBLOCKS*TURBOSHAKE128_RATE+2];
+  uint8_t xy[2];
+  keccak_state state;
+
+  xy[0] = i;
+  xy[1] = GENX4_VECTOR_Y;
+  turboshake128_init(&state);
+  turboshake128_absorb(&state,seed,KYBER_SYMBYTES);
+  turboshake128_absorb(&state,xy,2);
+  turboshake128_finalize(&state,TURBOSHAKE_DS_XOF);
+  turboshake128_squeezeblocks(buf,GEN_POLY_NBLOCKS,&state);
+  buflen = GEN_POLY_NBLOCKS*TURBOSHAKE128_RATE;
+  ctr = rej_uniform_fast(r->coeffs,KYBER_N,buf,buflen);
+  while(ctr < KYBER_N) {
+    off = buflen % 3;
+    for(k=0;k<off;k++)
+      buf[k] = buf[buflen-off+k];
+    turboshake128_squeezeblocks(buf+off,1,&state);
+    buflen = off + TURBOSHAKE128_RATE;
+    ctr += rej_uniform_fast(r->coeffs+ctr,KYBER_N-ctr,buf,buflen);
+  }
+}
+
+/*************************************************
+* Name:        gen_vector_turboshake
+*
+* Description: gen_vector on TurboSHAKE128 streams, four polynomials
+*              at a time where the CPU has AVX2
+*
+* Arguments:   - polyvec *a: pointer to output vector
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+**************************************************/
+void gen_vector_turboshake(polyvec *a, const uint8_t seed[KYBER_SYMBYTES])
+{
+  unsigned int i;
+#if defined(GENX4) && !defined(PAKE_NO_KECCAKX4)
+  unsigned int l, n;
+  uint8_t x[4], y[4];
+  poly *r[4];
+
+  if(genx4_available()) {
+    for(i=0;i<KYBER_K;i+=n) {
+      n = KYBER_K-i < 4 ? KYBER_K-i : 4;
+      for(l=0;l<4;l++) {
+        r[l] = &a->vec[i + (l < n ? l : 0)];
+        x[l] = i+l;
+        y[l] = GENX4_VECTOR_Y;
+      }
+      gen_x4(r,n,seed,x,y,TURBOSHAKE_DS_XOF,TURBOSHAKE_NROUNDS);
+    }
+    return;
+  }
+#endif
+  for(i=0;i<KYBER_K;i++)
+    gen_vector_poly_turboshake(&a->vec[i],seed,i);
+}
+
+/*************************************************
+* Name:        gen_matrix_x4
+*
+* Description: gen_matrix, four polynomials at a time
+*
+* Arguments:   - polyvec *a: pointer to output matrix
+*              - const uint8_t *seed: pointer to input seed
+*                                     (of length KYBER_SYMBYTES bytes)
+*              - int transposed: whether to generate A^T
+**************************************************/
+void gen_matrix_x4(polyvec *a, const uint8_t seed[KYBER_SYMBYTES], int transposed)
+{
+#ifdef GENX4
+  unsigned int i, l, n;
+  uint8_t x[4], y[4];
+  poly *r[4];
+
+  if(genx4_available()) {
+    for(i=0;i<KYBER_K*KYBER_K;i+=n) {
+      n = KYBER_K*KYBER_K-i < 4 ? KYBER_K*KYBER_K-i : 4;
+      for(l=0;l<4;l++) {
+        unsigned int row = (i + (l < n ? l : 0)) / KYBER_K;
+        unsigned int col = (i + (l < n ? l : 0)) % KYBER_K;
+        r[l] = &a[row].vec[col];
+        x[l] = transposed ? row : col;
+        y[l] = transposed ? col : row;
+      }
+      gen_x4(r,n,seed,x,y,GENX4_SHAKE_DS,NROUNDS);
+    }
+    return;
+  }
+#endif
+  gen_matrix(a,seed,transposed);
+}
+
+/*************************************************
+* Name:        keccakx4_permute
+*
+* Description: Permutes all four lanes of a keccakx4_state, on the x4
+*              Keccak where available
+**************************************************/
+static void keccakx4_permute(keccakx4_state *state)
+{
+  unsigned int i, l;
+  uint64_t t[25];
+
+#ifdef GENX4
+  if(genx4_available()) {
+    keccakx4_permute_avx2(state->s,state->nrounds);
+    return;
+  }
+#endif
+  for(l=0;l<4;l++) {
+    for(i=0;i<25;i++)
+      t[i] = state->s[4*i+l];
+    if(state->nrounds == TURBOSHAKE_NROUNDS)
+      KeccakP1600_12_StatePermute_fast(t);
+    else
+      KeccakF1600_StatePermute_fast(t);
+    for(i=0;i<25;i++)
+      state->s[4*i+l] = t[i];
+  }
+}
+
+/*************************************************
+* Name:        keccakx4_init
+*
+* Description: Starts four empty sponges
+*
+* Arguments:   - keccakx4_state *state: pointer to the state
+*              - unsigned int rate: the rate in bytes
+*              - unsigned int nrounds: 24, or 12 for TurboSHAKE
+**************************************************/
+void keccakx4_init(keccakx4_state *state, unsigned int rate, unsigned int nrounds)
+{
+  memset(state->s,0,sizeof(state->s));
+  state->pos = 0;
+  state->rate = rate;
+  state->nrounds = nrounds;
+}
+
+/*************************************************
+* Name:        keccakx4_absorb
+*
+* Description: Absorbs inlen bytes into each lane, in[l] into lane l
+*
+* Arguments:   - keccakx4_state *state: pointer to the state
+*              - const uint8_t *in[4]: the four inputs
+*              - size_t inlen: length of each input
+**************************************************/
+void keccakx4_absorb(keccakx4_state *state, const uint8_t *in[4], size_t inlen)
+{
+  unsigned int l, pos = state->pos;
+  size_t i = 0;
+  uint64_t t;
+
+  while(i < inlen) {
+    if(pos % 8 == 0 && inlen-i >= 8) {
+      for(l=0;l<4;l++) {
+        memcpy(&t,in[l]+i,8);
+        state->s[4*(pos/8)+l] ^= t;
+      }
+      pos += 8;
+      i += 8;
+    } else {
+      for(l=0;l<4;l++)
+        state->s[4*(pos/8)+l] ^= (uint64_t)in[l][i] << 8*(pos%8);
+      pos++;
+      i++;
+    }
+    if(pos == state->rate) {
+      keccakx4_permute(state);
+      pos = 0;
+    }
+  }
+  state->pos = pos;
+}
+
+/*************************************************
+* Name:        keccakx4_final
+*
+* Description: Pads every lane with ds and squeezes outlen bytes out
+*              of lane l into out[l]
+*
+* Arguments:   - uint8_t *out[4]: the four outputs
+*              - size_t outlen: length of each output
+*              - keccakx4_state *state: pointer to the state
+*              - uint8_t ds: the domain/padding byte
+**************************************************/
+void keccakx4_final(uint8_t *out[4], size_t outlen, keccakx4_state *state, uint8_t ds)
+{
+  unsigned int i, l, n;
+  size_t off = 0;
+
+  for(l=0;l<4;l++) {
+    state->s[4*(state->pos/8)+l] ^= (uint64_t)ds << 8*(state->pos%8);
+    state->s[4*((state->rate-1)/8)+l] ^= 1ULL << 63;
+  }
+  while(outlen > 0) {
+    keccakx4_permute(state);
+    n = outlen < state->rate ? outlen : state->rate;
+    for(i=0;i<n;i++)
+      for(l=0;l<4;l++)
+        out[l][off+i] = state->s[4*(i/8)+l] >> 8*(i%8);
+    off += n;
+    outlen -= n;
+  }
+  state->pos = 0;
+}
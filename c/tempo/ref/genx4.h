@@ -0,0 +1,108 @@
+#ifndef GENX4_H
+#define GENX4_H
+
+#include <stdint.h>
+#include "params.h"
+#include "poly.h"
+#include "polyvec.h"
+#include "sha3inc.h"
+#include "turboshake.h"
+
+/*
+  gen_vector and gen_matrix with the SHAKE-128 streams of four
+  polynomials squeezed together by an AVX2 Keccak-f1600x4. The CPU
+  is checked at run time; without AVX2 both fall back to the Kyber
+  ref functions. Outputs match those bit for bit: polynomial i of
+  gen_vector is rejection-sampled from SHAKE-128(seed||i||0xFF), the
+  layout of gen_vector in the Kyber submodule (test_pake checks
+  this), and gen_matrix is the ML-KEM one.
+
+  pake_gen_vector/pake_gen_matrix pick the x4 versions only where
+  they compute the same function: not with TEMPO_VECTOR_ALG, resp.
+  TEMPO_MATRIX_ALG, set, nor with PAKE_NO_KECCAKX4. With
+  TEMPO_VECTOR_ALG=2 pake_gen_vector is the native AES-256-CTR one
+  from aes256ctr.h; PAKE_NO_AESNI only forces its portable AES.
+
+  PAKE_TURBOSHAKE makes the mask a different function:
+  gen_vector_turboshake samples polynomial i from
+  TurboSHAKE128(seed||i||0xFF) with domain byte TURBOSHAKE_DS_XOF,
+  12 rounds instead of 24, on the x4 Keccak where available (and
+  PAKE_NO_KECCAKX4 is not set). It
+  replaces only the SHAKE-128 layout; TEMPO_VECTOR_ALG values keep
+  their generators.
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GENX4 1
+#endif
+
+#define GENX4_VECTOR_Y 0xFF
+
+int genx4_available(void);
+
+void gen_vector_x4(polyvec *a, const uint8_t seed[KYBER_SYMBYTES]);
+void gen_matrix_x4(polyvec *a, const uint8_t seed[KYBER_SYMBYTES], int transposed);
+void gen_vector_turboshake(polyvec *a, const uint8_t seed[KYBER_SYMBYTES]);
+void gen_vector_poly_turboshake(poly *r, const uint8_t seed[KYBER_SYMBYTES], unsigned int i);
+
+#if defined(PAKE_TURBOSHAKE) && !defined(TEMPO_VECTOR_ALG)
+#define GENTURBO_VECTOR 1
+#define pake_gen_vector(A, SEED) gen_vector_turboshake(A, SEED)
+#elif !defined(PAKE_NO_KECCAKX4) && !defined(TEMPO_VECTOR_ALG)
+#define GENX4_VECTOR 1
+#define pake_gen_vector(A, SEED) gen_vector_x4(A, SEED)
+#elif defined(TEMPO_VECTOR_ALG) && TEMPO_VECTOR_ALG == 2
+#include "aes256ctr.h"
+#define GENAES_VECTOR 1
+#define pake_gen_vector(A, SEED) gen_vector_aes256ctr(A, SEED)
+#else
+#define pake_gen_vector(A, SEED) gen_vector(A, SEED)
+#endif
+
+/*
+  Four sponges absorbed in lockstep, for hashing equal-length inputs
+  of independent sessions together (resp_batch, initEnd_batch): the
+  x4 Keccak above when the CPU has AVX2, four single-state
+  permutations (keccakf1600.c) otherwise. Lane l of keccakx4_absorb
+  reads in[l] and keccakx4_final writes out[l]; each lane gives what
+  the single-state hash over the same input would. rate is in bytes,
+  nrounds 24 (SHA3) or 12 (TurboSHAKE), ds the padding byte.
+*/
+typedef struct {
+  uint64_t s[4*25] __attribute__((aligned(32)));
+  unsigned int pos;
+  unsigned int rate;
+  unsigned int nrounds;
+} keccakx4_state;
+
+void keccakx4_init(keccakx4_state *state, unsigned int rate, unsigned int nrounds);
+void keccakx4_absorb(keccakx4_state *state, const uint8_t *in[4], size_t inlen);
+void keccakx4_final(uint8_t *out[4], size_t outlen, keccakx4_state *state, uint8_t ds);
+
+#define GENX4_SHA3_DS 0x06
+
+// four-lane hash_h/hash_g and mask_hash_h of sha3inc.h
+#define hash_hx4_init(STATE) keccakx4_init(STATE, SHA3_256_RATE, 24)
+#define hash_hx4_absorb(STATE, IN, INBYTES) keccakx4_absorb(STATE, IN, INBYTES)
+#define hash_hx4_final(OUT, STATE) keccakx4_final(OUT, 32, STATE, GENX4_SHA3_DS)
+#define hash_gx4_init(STATE) keccakx4_init(STATE, SHA3_512_RATE, 24)
+#define hash_gx4_absorb(STATE, IN, INBYTES) keccakx4_absorb(STATE, IN, INBYTES)
+#define hash_gx4_final(OUT, STATE) keccakx4_final(OUT, 64, STATE, GENX4_SHA3_DS)
+
+#ifdef PAKE_TURBOSHAKE
+#define mask_hash_hx4_init(STATE) keccakx4_init(STATE, TURBOSHAKE256_RATE, TURBOSHAKE_NROUNDS)
+#define mask_hash_hx4_final(OUT, STATE) keccakx4_final(OUT, 32, STATE, TURBOSHAKE_DS_HASH_H)
+#else
+#define mask_hash_hx4_init(STATE) hash_hx4_init(STATE)
+#define mask_hash_hx4_final(OUT, STATE) hash_hx4_final(OUT, STATE)
+#endif
+#define mask_hash_hx4_absorb(STATE, IN, INBYTES) keccakx4_absorb(STATE, IN, INBYTES)
+
+#if !defined(PAKE_NO_KECCAKX4) && !defined(TEMPO_MATRIX_ALG)
+#define GENX4_MATRIX 1
+#define pake_gen_matrix(A, SEED, T) gen_matrix_x4(A, SEED, T)
+#else
+#define pake_gen_matrix(A, SEED, T) gen_matrix(A, SEED, T)
+#endif
+
+#endif
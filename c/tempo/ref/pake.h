@@ -1,6 +1,7 @@
 #ifndef PAKE_H
 #define PAKE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "params.h"
 
@@ -26,4 +27,116 @@ void resp(uint8_t key[KYBER_SYMBYTES],                // out
             const uint8_t pw[KYBER_SYMBYTES],         // in
             const uint8_t sid[KYBER_SYMBYTES]);       // stin
 
+/*
+  Batched responder and initiator end: n sessions, PAKE_BATCH at a
+  time in lockstep, so that the hashes over pk, msg1 and the
+  transcript run four sessions per (AVX2) Keccak call. Each output
+  is the one of the corresponding single call.
+*/
+#define PAKE_BATCH 8
+
+void resp_batch(uint8_t (*key)[KYBER_SYMBYTES],             // out
+                uint8_t (*msg2)[MSG2_LEN],                  // out
+                const uint8_t (*msg1)[MSG1_LEN],            // in
+                const uint8_t (*pw)[KYBER_SYMBYTES],        // in
+                const uint8_t (*sid)[KYBER_SYMBYTES],       // stin
+                size_t n);
+
+int initEnd_batch(uint8_t (*key)[KYBER_SYMBYTES],           // out
+                  int *result,                              // out, 0 iff OK
+                  const uint8_t (*msg2)[MSG2_LEN],          // in
+                  const uint8_t (*msg1)[MSG1_LEN],          // stin
+                  const uint8_t (*pk)[KYBER_PUBLICKEYBYTES],// stin
+                  const uint8_t (*sk)[KYBER_SECRETKEYBYTES],// stin
+                  const uint8_t (*sid)[KYBER_SYMBYTES],     // stin
+                  size_t n);                                // return 0 iff all OK
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+#include "sha3inc.h"
+
+/*
+  With PAKE_TRANSCRIPT_PREFIX the transcript is hashed as
+  H(sid,pk,apk,cph,K_s), so the initiator can absorb sid, pk and msg1
+  right after sending msg1 and keep only sk and the Keccak state
+  instead of msg1, pk and sk.
+*/
+typedef struct {
+  keccak_state transcript;
+  uint8_t sk[KYBER_SECRETKEYBYTES];
+} pake_init_state;
+
+void initStartPrefix(uint8_t msg1[MSG1_LEN],             // out
+                     pake_init_state *st,                // stupd
+                     const uint8_t pw[KYBER_SYMBYTES],   // in
+                     const uint8_t sid[KYBER_SYMBYTES]); // in
+
+int initEndPrefix(uint8_t key[KYBER_SYMBYTES],           // out + return 0 iff OK
+                  const uint8_t msg2[MSG2_LEN],          // in
+                  const pake_init_state *st);            // stin
+#endif
+
+#ifdef PAKE_KEYPOOL
+#include "keypool.h"
+
+void initStartPool(uint8_t msg1[MSG1_LEN], // stupd and out
+                   uint8_t pk[KYBER_PUBLICKEYBYTES],   // stupd
+                   uint8_t sk[KYBER_SECRETKEYBYTES],   // stupd
+                   const uint8_t pw[KYBER_SYMBYTES],   // in
+                   const uint8_t sid[KYBER_SYMBYTES],  // stin
+                   keypool *pool);                     // in
+#endif
+
+#ifdef PAKE_COMPACT_STATE
+#include "sha3inc.h"
+
+/*
+  With PAKE_COMPACT_STATE the initiator keeps the 64-byte keygen seed
+  (d,z) instead of pk and sk, and initEndCompact regenerates the
+  keypair from it. msg1 is recomputed from pw and the nonce, which are
+  kept as well; with PAKE_TRANSCRIPT_PREFIX the absorbed transcript is
+  kept instead of pw and the nonce.
+*/
+typedef struct {
+  uint8_t seed[2*KYBER_SYMBYTES];
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  keccak_state transcript;
+#else
+  uint8_t pw[KYBER_SYMBYTES];
+  uint8_t nonce[KYBER_SYMBYTES];
+#endif
+} pake_compact_state;
+
+void initStartCompact(uint8_t msg1[MSG1_LEN],             // out
+                      pake_compact_state *st,             // stupd
+                      const uint8_t pw[KYBER_SYMBYTES],   // in
+                      const uint8_t sid[KYBER_SYMBYTES]); // stin
+
+int initEndCompact(uint8_t key[KYBER_SYMBYTES],           // out + return 0 iff OK
+                   const uint8_t msg2[MSG2_LEN],          // in
+                   const pake_compact_state *st,          // stin
+                   const uint8_t sid[KYBER_SYMBYTES]);    // stin
+#endif
+
+#ifdef PAKE_FAT_STATE
+#include "kemfat.h"
+
+/*
+  With PAKE_FAT_STATE the initiator keeps the unpacked secret key
+  (NTT-domain A^T, t and s) instead of the packed sk, so initEndFat
+  decapsulates without expanding A or unpacking pk and sk again.
+*/
+void initStartFat(uint8_t msg1[MSG1_LEN],              // out
+                  uint8_t pk[KYBER_PUBLICKEYBYTES],    // stupd
+                  kem_fat_sk *sk,                      // stupd
+                  const uint8_t pw[KYBER_SYMBYTES],    // in
+                  const uint8_t sid[KYBER_SYMBYTES]);  // stin
+
+int initEndFat(uint8_t key[KYBER_SYMBYTES],            // out + return 0 iff OK
+               const uint8_t msg2[MSG2_LEN],           // in
+               const uint8_t msg1[MSG1_LEN],           // stin
+               const uint8_t pk[KYBER_PUBLICKEYBYTES], // stin
+               const kem_fat_sk *sk,                   // stin
+               const uint8_t sid[KYBER_SYMBYTES]);     // stin
+#endif
+
 #endif
@@ -0,0 +1,155 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "params.h"
+#include "fips202.h"
+#include "keccakf1600.h"
+#include "randombytes.h"
+#include "randbuf.h"
+
+// one refill: the next key, then the bytes served
+#define RANDBUF_STREAM (30*SHAKE256_RATE)
+
+// for wiping locals on the way out, which a plain memset would be a
+// dead store to
+static void *(*const volatile randbuf_memset)(void *, int, size_t) = memset;
+
+typedef struct {
+  uint8_t key[KYBER_SYMBYTES];
+  uint8_t stream[RANDBUF_STREAM];
+  size_t pos;                   // next unserved byte of stream
+  uint64_t ctr;                 // refills since the last (re)seed
+  unsigned int left;            // refills before the next reseed
+  int seeded;
+  int deterministic;
+  uint64_t calls;
+  uint64_t syscalls;
+} randbuf_state;
+
+static _Thread_local randbuf_state rb = { .pos = RANDBUF_STREAM };
+
+static pthread_once_t randbuf_once = PTHREAD_ONCE_INIT;
+
+// the child must not replay the parent's buffer or key stream
+static void randbuf_atfork_child(void)
+{
+  memset(rb.stream,0,sizeof(rb.stream));
+  rb.pos = RANDBUF_STREAM;
+  if(!rb.deterministic)
+    rb.seeded = 0;
+}
+
+static void randbuf_register(void)
+{
+  pthread_atfork(NULL, NULL, randbuf_atfork_child);
+}
+
+/*************************************************
+* Name:        randbuf_reseed
+*
+* Description: Mixes 32 bytes from getrandom into the key of the
+*              calling thread
+**************************************************/
+static void randbuf_reseed(void)
+{
+  uint8_t in[2*KYBER_SYMBYTES];
+  uint8_t *out = in+KYBER_SYMBYTES;
+  size_t outlen = KYBER_SYMBYTES;
+  long ret;
+
+  pthread_once(&randbuf_once, randbuf_register);
+  while(outlen > 0) {
+    ret = syscall(SYS_getrandom, out, outlen, 0);
+    rb.syscalls++;
+    if(ret == -1 && errno == EINTR) continue;
+    else if(ret == -1) _exit(1);
+    out += ret; outlen -= (size_t)ret;
+  }
+  memcpy(in,rb.key,KYBER_SYMBYTES);
+  shake256(rb.key,KYBER_SYMBYTES,in,sizeof(in));
+  randbuf_memset(in,0,sizeof(in));
+
+  rb.ctr = 0;
+  rb.left = RANDBUF_RESEED;
+  rb.seeded = 1;
+}
+
+/*************************************************
+* Name:        randbuf_refill
+*
+* Description: Squeezes the next stream from the key and the counter
+*              and replaces the key with its first 32 bytes
+**************************************************/
+static void randbuf_refill(void)
+{
+  uint8_t in[KYBER_SYMBYTES+8];
+  keccak_state state;
+  unsigned int i, j;
+
+  if(!rb.deterministic && (!rb.seeded || rb.left == 0))
+    randbuf_reseed();
+
+  memcpy(in,rb.key,KYBER_SYMBYTES);
+  for(i=0;i<8;i++)
+    in[KYBER_SYMBYTES+i] = (uint8_t)(rb.ctr >> 8*i);
+  // shake256, squeezed with the unrolled permutation
+  shake256_absorb_once(&state,in,sizeof(in));
+  for(i=0;i<RANDBUF_STREAM;i+=SHAKE256_RATE) {
+    KeccakF1600_StatePermute_fast(state.s);
+    for(j=0;j<SHAKE256_RATE;j++)
+      rb.stream[i+j] = (uint8_t)(state.s[j/8] >> 8*(j%8));
+  }
+  randbuf_memset(in,0,sizeof(in));
+  randbuf_memset(&state,0,sizeof(state));
+
+  memcpy(rb.key,rb.stream,KYBER_SYMBYTES);
+  memset(rb.stream,0,KYBER_SYMBYTES);
+  rb.pos = KYBER_SYMBYTES;
+  rb.ctr++;
+  if(rb.left > 0)
+    rb.left--;
+}
+
+void randombytes(uint8_t *out, size_t outlen)
+{
+  size_t n;
+
+  rb.calls++;
+  while(outlen > 0) {
+    if(rb.pos == RANDBUF_STREAM)
+      randbuf_refill();
+    n = RANDBUF_STREAM - rb.pos;
+    if(n > outlen)
+      n = outlen;
+    memcpy(out,rb.stream+rb.pos,n);
+    memset(rb.stream+rb.pos,0,n);
+    rb.pos += n;
+    out += n;
+    outlen -= n;
+  }
+}
+
+void randbuf_seed(const uint8_t seed[KYBER_SYMBYTES])
+{
+  memset(rb.stream,0,sizeof(rb.stream));
+  rb.pos = RANDBUF_STREAM;
+  rb.ctr = 0;
+  if(seed == NULL) {
+    rb.deterministic = 0;
+    rb.seeded = 0;
+  } else {
+    memcpy(rb.key,seed,KYBER_SYMBYTES);
+    rb.deterministic = 1;
+    rb.seeded = 1;
+  }
+}
+
+void randbuf_stats(uint64_t *calls, uint64_t *syscalls)
+{
+  *calls = rb.calls;
+  *syscalls = rb.syscalls;
+}
@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "params.h"
+#include "pake.h"
+#include "respengine.h"
+
+typedef struct {
+  // deque of pending jobs: the owner takes from head (oldest),
+  // thieves from tail (newest)
+  pthread_mutex_t lock;
+  respengine_job **ring;
+  size_t mask;
+  size_t head;
+  size_t tail;
+
+  // contiguous copies of a batch for resp_batch
+  uint8_t msg1[PAKE_BATCH][MSG1_LEN];
+  uint8_t pw[PAKE_BATCH][KYBER_SYMBYTES];
+  uint8_t sid[PAKE_BATCH][KYBER_SYMBYTES];
+  uint8_t key[PAKE_BATCH][KYBER_SYMBYTES];
+  uint8_t msg2[PAKE_BATCH][MSG2_LEN];
+
+  unsigned int id;
+  pthread_t thread;
+  respengine *engine;
+} respengine_worker;
+
+struct respengine {
+  respengine_worker *workers;
+  unsigned int nthreads;
+  unsigned int batch;
+  int pin;
+  size_t max_pending;
+  atomic_size_t inflight;          // accepted, not completed yet
+  atomic_size_t queued;            // accepted, not taken by a worker yet
+  atomic_uint next;                // deque of the next submission
+  atomic_int running;
+  atomic_uint_fast64_t completed;
+  atomic_uint_fast64_t rejected;
+  atomic_uint_fast64_t stolen;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;             // a job was queued, or stopping
+  pthread_cond_t idle;             // inflight dropped to zero
+};
+
+/*************************************************
+* Name:        respengine_take
+*
+* Description: Moves up to n jobs out of the deque of w, the oldest
+*              ones for its owner, the newest ones for a thief
+*
+* Returns the number of jobs taken
+**************************************************/
+static unsigned int respengine_take(respengine_worker *w,
+                                    respengine_job **jobs,
+                                    unsigned int n, int steal)
+{
+  unsigned int k = 0;
+
+  pthread_mutex_lock(&w->lock);
+  while(k < n && w->head != w->tail) {
+    if(steal)
+      jobs[k++] = w->ring[--w->tail & w->mask];
+    else
+      jobs[k++] = w->ring[w->head++ & w->mask];
+  }
+  pthread_mutex_unlock(&w->lock);
+  return k;
+}
+
+/*************************************************
+* Name:        respengine_process
+*
+* Description: Answers n jobs, with resp_batch when there is more
+*              than one, and runs their callbacks
+**************************************************/
+static void respengine_process(respengine_worker *w,
+                               respengine_job **jobs,
+                               unsigned int n)
+{
+  unsigned int j;
+
+  if(n == 1) {
+    resp(jobs[0]->key,jobs[0]->msg2,jobs[0]->msg1,jobs[0]->pw,jobs[0]->sid);
+  } else {
+    for(j=0;j<n;j++) {
+      memcpy(w->msg1[j],jobs[j]->msg1,MSG1_LEN);
+      memcpy(w->pw[j],jobs[j]->pw,KYBER_SYMBYTES);
+      memcpy(w->sid[j],jobs[j]->sid,KYBER_SYMBYTES);
+    }
+    resp_batch(w->key,w->msg2,(const uint8_t (*)[MSG1_LEN])w->msg1,
+               (const uint8_t (*)[KYBER_SYMBYTES])w->pw,
+               (const uint8_t (*)[KYBER_SYMBYTES])w->sid,n);
+    for(j=0;j<n;j++) {
+      memcpy(jobs[j]->key,w->key[j],KYBER_SYMBYTES);
+      memcpy(jobs[j]->msg2,w->msg2[j],MSG2_LEN);
+    }
+    // passwords and keys are secret material
+    memset(w->pw,0,sizeof(w->pw));
+    memset(w->key,0,sizeof(w->key));
+  }
+
+  for(j=0;j<n;j++) {
+    if(jobs[j]->done != NULL)
+      jobs[j]->done(jobs[j]);
+  }
+}
+
+static void *respengine_run(void *arg)
+{
+  respengine_worker *w = arg;
+  respengine *e = w->engine;
+  respengine_job *jobs[PAKE_BATCH];
+  unsigned int i, n;
+  int stop;
+
+#ifdef __linux__
+  if(e->pin) {
+    cpu_set_t set;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+    CPU_ZERO(&set);
+    CPU_SET(w->id % (ncpu > 0 ? (unsigned long)ncpu : 1), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+
+  for(;;) {
+    n = respengine_take(w,jobs,e->batch,0);
+    for(i=1;n==0 && i<e->nthreads;i++) {
+      n = respengine_take(&e->workers[(w->id+i) % e->nthreads],jobs,e->batch,1);
+      if(n)
+        atomic_fetch_add_explicit(&e->stolen, n, memory_order_relaxed);
+    }
+
+    if(n == 0) {
+      pthread_mutex_lock(&e->lock);
+      while(atomic_load(&e->queued) == 0 && atomic_load(&e->running))
+        pthread_cond_wait(&e->wake,&e->lock);
+      stop = atomic_load(&e->queued) == 0;
+      pthread_mutex_unlock(&e->lock);
+      if(stop)
+        break;
+      continue;
+    }
+
+    atomic_fetch_sub(&e->queued, n);
+    respengine_process(w,jobs,n);
+    atomic_fetch_add_explicit(&e->completed, n, memory_order_relaxed);
+
+    if(atomic_fetch_sub(&e->inflight, n) == n) {
+      pthread_mutex_lock(&e->lock);
+      pthread_cond_broadcast(&e->idle);
+      pthread_mutex_unlock(&e->lock);
+    }
+  }
+  return NULL;
+}
+
+// stops and joins the first n workers
+static void respengine_stop(respengine *e, unsigned int n)
+{
+  unsigned int i;
+
+  pthread_mutex_lock(&e->lock);
+  atomic_store(&e->running, 0);
+  pthread_cond_broadcast(&e->wake);
+  pthread_mutex_unlock(&e->lock);
+  for(i=0;i<n;i++)
+    pthread_join(e->workers[i].thread, NULL);
+}
+
+static void respengine_release(respengine *e)
+{
+  unsigned int i;
+
+  for(i=0;i<e->nthreads;i++) {
+    pthread_mutex_destroy(&e->workers[i].lock);
+    free(e->workers[i].ring);
+  }
+  pthread_mutex_destroy(&e->lock);
+  pthread_cond_destroy(&e->wake);
+  pthread_cond_destroy(&e->idle);
+  free(e->workers);
+  free(e);
+}
+
+respengine *respengine_new(unsigned int nthreads, size_t max_pending,
+                           unsigned int batch, int pin)
+{
+  respengine *e;
+  size_t cap = 1;
+  unsigned int i;
+  long ncpu;
+
+  if(nthreads == 0) {
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = ncpu > 0 ? (unsigned int)ncpu : 1;
+  }
+  if(max_pending == 0)
+    max_pending = 1;
+  if(batch == 0)
+    batch = 1;
+  if(batch > PAKE_BATCH)
+    batch = PAKE_BATCH;
+  // no more than max_pending jobs are ever queued, so no deque fills up
+  while(cap < max_pending)
+    cap <<= 1;
+
+  e = calloc(1, sizeof(respengine));
+  if(e == NULL)
+    return NULL;
+  e->workers = calloc(nthreads, sizeof(respengine_worker));
+  if(e->workers == NULL) {
+    free(e);
+    return NULL;
+  }
+  e->nthreads = nthreads;
+  e->batch = batch;
+  e->pin = pin;
+  e->max_pending = max_pending;
+  atomic_init(&e->inflight, 0);
+  atomic_init(&e->queued, 0);
+  atomic_init(&e->next, 0);
+  atomic_init(&e->running, 1);
+  atomic_init(&e->completed, 0);
+  atomic_init(&e->rejected, 0);
+  atomic_init(&e->stolen, 0);
+  pthread_mutex_init(&e->lock, NULL);
+  pthread_cond_init(&e->wake, NULL);
+  pthread_cond_init(&e->idle, NULL);
+
+  for(i=0;i<nthreads;i++) {
+    respengine_worker *w = &e->workers[i];
+    pthread_mutex_init(&w->lock, NULL);
+    w->ring = malloc(cap*sizeof(respengine_job *));
+    w->mask = cap-1;
+    w->id = i;
+    w->engine = e;
+    if(w->ring == NULL) {
+      respengine_release(e);
+      return NULL;
+    }
+  }
+
+  for(i=0;i<nthreads;i++) {
+    if(pthread_create(&e->workers[i].thread, NULL, respengine_run, &e->workers[i])) {
+      respengine_stop(e, i);
+      respengine_release(e);
+      return NULL;
+    }
+  }
+  return e;
+}
+
+void respengine_free(respengine *e)
+{
+  if(e == NULL)
+    return;
+  respengine_drain(e);
+  respengine_stop(e, e->nthreads);
+  respengine_release(e);
+}
+
+int respengine_submit(respengine *e, respengine_job *job)
+{
+  respengine_worker *w;
+
+  if(atomic_fetch_add(&e->inflight, 1) >= e->max_pending) {
+    atomic_fetch_sub(&e->inflight, 1);
+    atomic_fetch_add_explicit(&e->rejected, 1, memory_order_relaxed);
+    return -1;
+  }
+
+  // counted before it is visible, so queued never undercounts
+  atomic_fetch_add(&e->queued, 1);
+  w = &e->workers[atomic_fetch_add_explicit(&e->next, 1, memory_order_relaxed) % e->nthreads];
+  pthread_mutex_lock(&w->lock);
+  w->ring[w->tail++ & w->mask] = job;
+  pthread_mutex_unlock(&w->lock);
+
+  pthread_mutex_lock(&e->lock);
+  pthread_cond_signal(&e->wake);
+  pthread_mutex_unlock(&e->lock);
+  return 0;
+}
+
+void respengine_drain(respengine *e)
+{
+  pthread_mutex_lock(&e->lock);
+  while(atomic_load(&e->inflight) != 0)
+    pthread_cond_wait(&e->idle, &e->lock);
+  pthread_mutex_unlock(&e->lock);
+}
+
+unsigned int respengine_threads(const respengine *e)
+{
+  return e->nthreads;
+}
+
+void respengine_stats(respengine *e, uint64_t *completed,
+                      uint64_t *rejected, uint64_t *stolen)
+{
+  *completed = atomic_load_explicit(&e->completed, memory_order_relaxed);
+  *rejected = atomic_load_explicit(&e->rejected, memory_order_relaxed);
+  *stolen = atomic_load_explicit(&e->stolen, memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#ifndef EVP_REF_H
+#define EVP_REF_H
+
+/*
+  Reference for gen_vector_aes256ctr on OpenSSL EVP AES-256-CTR, one
+  cipher context per polynomial. Used by the _tmp2 tests and speed
+  runs, which link -lcrypto.
+*/
+
+#include <string.h>
+#include <openssl/evp.h>
+#include "params.h"
+#include "polyvec.h"
+#include "rej_uniform.h"
+
+#define EVP_REF_NBLOCKS ((12*KYBER_N/8*(1 << 12)/KYBER_Q + 64)/64)
+
+static void evp_ref_squeeze(EVP_CIPHER_CTX *ctx, uint8_t *out, int outlen)
+{
+  static const uint8_t zero[64] = {0};
+  int len, i;
+
+  for(i=0;i<outlen;i+=64)
+    EVP_EncryptUpdate(ctx, out+i, &len, zero, 64);
+}
+
+static void gen_vector_evp(polyvec *a, const uint8_t seed[KYBER_SYMBYTES])
+{
+  unsigned int ctr, i, k, buflen, off;
+  uint8_t buf[EVP_REF_NBLOCKS*64+2];
+  uint8_t iv[16] = {0};
+  EVP_CIPHER_CTX *ctx;
+
+  for(i=0;i<KYBER_K;i++) {
+    iv[0] = i;
+    iv[1] = GENX4_VECTOR_Y;
+    ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_256_ctr(), NULL, seed, iv);
+    evp_ref_squeeze(ctx, buf, EVP_REF_NBLOCKS*64);
+    buflen = EVP_REF_NBLOCKS*64;
+    ctr = rej_uniform(a->vec[i].coeffs, KYBER_N, buf, buflen);
+    while(ctr < KYBER_N) {
+      off = buflen % 3;
+      for(k=0;k<off;k++)
+        buf[k] = buf[buflen-off+k];
+      evp_ref_squeeze(ctx, buf+off, 64);
+      buflen = off + 64;
+      ctr += rej_uniform(a->vec[i].coeffs+ctr, KYBER_N-ctr, buf, buflen);
+    }
+    EVP_CIPHER_CTX_free(ctx);
+  }
+}
+
+#endif
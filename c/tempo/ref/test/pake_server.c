@@ -0,0 +1,238 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "../pake.h"
+#include "loopback.h"
+
+/*
+  Loopback PAKE responder: a single-threaded, non-blocking epoll
+  server on 127.0.0.1 answering every sid || msg1 frame with resp.
+
+  usage: pake_server [-c] [port] [handshakes]
+
+  With a handshake count, the server exits once it has answered that
+  many and every client has disconnected; otherwise it runs until
+  SIGINT/SIGTERM. On exit it prints handshakes/s over the time since
+  the first connection and its CPU time per handshake. -c appends
+  SHA3-256(key) to msg2 so that pake_client can check the keys.
+*/
+
+#define MAXEVENTS 64
+
+typedef struct {
+  int fd;
+  uint8_t in[LOOPBACK_HDR+LOOPBACK_REQ];
+  size_t inlen;
+  uint8_t out[LOOPBACK_HDR+LOOPBACK_RSP_TAG];
+  size_t outlen;
+  size_t outpos;
+} conn;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stop = 1;
+}
+
+static void conn_close(int ep, conn *c, unsigned long *nconn)
+{
+  epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+  close(c->fd);
+  free(c);
+  (*nconn)--;
+}
+
+// writes what it can of the pending msg2; 1 when done, 0 on EAGAIN, -1 on error
+static int conn_flush(conn *c)
+{
+  ssize_t r;
+
+  while(c->outpos < c->outlen) {
+    r = send(c->fd, c->out+c->outpos, c->outlen-c->outpos, MSG_NOSIGNAL);
+    if(r < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    c->outpos += (size_t)r;
+  }
+  c->outlen = c->outpos = 0;
+  return 1;
+}
+
+// answers a complete request into c->out
+static void conn_answer(conn *c, const uint8_t pw[KYBER_SYMBYTES], int confirm)
+{
+  uint8_t key[KYBER_SYMBYTES];
+  const uint8_t *sid = c->in+LOOPBACK_HDR;
+  const uint8_t *msg1 = sid+KYBER_SYMBYTES;
+  size_t len = confirm ? LOOPBACK_RSP_TAG : LOOPBACK_RSP;
+
+  resp(key,c->out+LOOPBACK_HDR,msg1,pw,sid);
+  if(confirm)
+    sha3_256(c->out+LOOPBACK_HDR+MSG2_LEN,key,KYBER_SYMBYTES);
+  memset(key,0,sizeof(key));
+  loopback_put32(c->out,(uint32_t)len);
+  c->outlen = LOOPBACK_HDR+len;
+  c->outpos = 0;
+  c->inlen = 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  struct epoll_event ev, events[MAXEVENTS];
+  struct timespec start = {0, 0}, now;
+  uint8_t pw[KYBER_SYMBYTES];
+  unsigned long served = 0, nconn = 0, count = 0;
+  double cpu0 = 0, secs;
+  int confirm = 0, port = LOOPBACK_PORT, one = 1;
+  int ls, ep, n, i, r;
+  ssize_t got;
+  size_t want;
+  conn *c;
+
+  if(argc > 1 && strcmp(argv[1],"-c") == 0) {
+    confirm = 1;
+    argc--; argv++;
+  }
+  if(argc > 1)
+    port = atoi(argv[1]);
+  if(argc > 2)
+    count = strtoul(argv[2],NULL,10);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  loopback_password(pw);
+
+  ls = socket(AF_INET, SOCK_STREAM, 0);
+  if(ls < 0) {
+    perror("socket");
+    return 1;
+  }
+  setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(ls, (struct sockaddr *)&addr, sizeof(addr)) || listen(ls, SOMAXCONN)
+     || loopback_nonblocking(ls)) {
+    perror("listen");
+    return 1;
+  }
+
+  ep = epoll_create1(0);
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;           // the listening socket
+  epoll_ctl(ep, EPOLL_CTL_ADD, ls, &ev);
+  printf("KYBER_K=%d, listening on 127.0.0.1:%d%s\n", KYBER_K, port,
+         confirm ? " (key confirmation)" : "");
+  fflush(stdout);
+
+  while(!stop && !(count && served >= count && nconn == 0)) {
+    n = epoll_wait(ep, events, MAXEVENTS, 1000);
+    if(n < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+
+    for(i=0;i<n;i++) {
+      c = events[i].data.ptr;
+
+      if(c == NULL) {
+        int fd;
+        while((fd = accept(ls, NULL, NULL)) >= 0) {
+          if(nconn == 0 && served == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            cpu0 = loopback_cpu();
+          }
+          c = calloc(1, sizeof(conn));
+          if(c == NULL || loopback_nonblocking(fd)) {
+            free(c);
+            close(fd);
+            continue;
+          }
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          c->fd = fd;
+          ev.events = EPOLLIN;
+          ev.data.ptr = c;
+          epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+          nconn++;
+        }
+        continue;
+      }
+
+      if(events[i].events & EPOLLOUT) {
+        r = conn_flush(c);
+        if(r < 0) {
+          conn_close(ep, c, &nconn);
+          continue;
+        }
+        if(r > 0) {
+          ev.events = EPOLLIN;
+          ev.data.ptr = c;
+          epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+        }
+        continue;
+      }
+
+      // read the header, then the rest of the request
+      for(;;) {
+        want = c->inlen < LOOPBACK_HDR ? LOOPBACK_HDR : LOOPBACK_HDR+LOOPBACK_REQ;
+        got = recv(c->fd, c->in+c->inlen, want-c->inlen, 0);
+        if(got <= 0) {
+          if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+          conn_close(ep, c, &nconn);
+          c = NULL;
+          break;
+        }
+        c->inlen += (size_t)got;
+        if(c->inlen == LOOPBACK_HDR && loopback_get32(c->in) != LOOPBACK_REQ) {
+          fprintf(stderr, "bad frame length %u\n", (unsigned int)loopback_get32(c->in));
+          conn_close(ep, c, &nconn);
+          c = NULL;
+          break;
+        }
+        if(c->inlen < LOOPBACK_HDR+LOOPBACK_REQ)
+          continue;
+
+        conn_answer(c, pw, confirm);
+        served++;
+        r = conn_flush(c);
+        if(r < 0) {
+          conn_close(ep, c, &nconn);
+          c = NULL;
+          break;
+        }
+        if(r == 0) {
+          // the client is slow to read; stop reading until msg2 is out
+          ev.events = EPOLLOUT;
+          ev.data.ptr = c;
+          epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+          break;
+        }
+      }
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  secs = (double)(now.tv_sec - start.tv_sec) + 1e-9*(double)(now.tv_nsec - start.tv_nsec);
+  if(served)
+    printf("server: %lu handshakes, %.0f handshakes/s, %.1f us CPU/handshake\n",
+           served, served/secs, 1e6*(loopback_cpu()-cpu0)/served);
+  close(ep);
+  close(ls);
+  return 0;
+}
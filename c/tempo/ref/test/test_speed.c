@@ -2,10 +2,25 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include "../twofeistel.h"
 #include "../pake.h"
+#include "../genx4.h"
+#include "../rejavx2.h"
+#include "../polymask.h"
+#include "../sha3inc.h"
+#include "indcpa.h"
+#include "rej_uniform.h"
+#ifdef GENAES_VECTOR
+#include "evp_ref.h"
+#endif
 #include "kem.h"
 #include "randombytes.h"
+#ifdef PAKE_RANDBUF
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "../randbuf.h"
+#endif
 #include "test/cpucycles.h"
 #include "test/speed_print.h"
 
@@ -14,6 +29,152 @@
 uint64_t t[NTESTS];
 uint8_t seed[KYBER_SYMBYTES] = {0};
 
+// input lengths of the hash_h and hash_g calls of one handshake
+static const size_t hlens[] = {3*KYBER_SYMBYTES,
+                               KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES,
+                               KYBER_PUBLICKEYBYTES};
+static const size_t glens[] = {2*KYBER_SYMBYTES,
+                               2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES};
+
+static void speed_hash(const char *name,
+                       void (*hash)(uint8_t *, const uint8_t *, size_t),
+                       size_t inlen)
+{
+  static uint8_t in[2*KYBER_SYMBYTES+2*KYBER_PUBLICKEYBYTES+KYBER_CIPHERTEXTBYTES];
+  uint8_t h[64];
+  char s[64];
+  unsigned int i;
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    hash(h,in,inlen);
+  }
+  snprintf(s,sizeof(s),"%s (%zu bytes): ",name,inlen);
+  print_results(s, t, NTESTS);
+  // print_results leaves the cycle counts sorted
+  printf("cycles/byte: %.2f\n\n",(double)t[(NTESTS-1)/2]/inlen);
+}
+
+// session counts for resp_batch/initEnd_batch
+#define NSPEEDBATCH 16
+static const size_t batchns[] = {1, 4, 8, NSPEEDBATCH};
+
+static void speed_batch(size_t n)
+{
+  static uint8_t sid[NSPEEDBATCH][CRYPTO_BYTES];
+  static uint8_t pw[NSPEEDBATCH][CRYPTO_BYTES];
+  static uint8_t sk[NSPEEDBATCH][CRYPTO_SECRETKEYBYTES];
+  static uint8_t pk[NSPEEDBATCH][CRYPTO_PUBLICKEYBYTES];
+  static uint8_t key[NSPEEDBATCH][CRYPTO_BYTES];
+  static uint8_t msg1[NSPEEDBATCH][MSG1_LEN];
+  static uint8_t msg2[NSPEEDBATCH][MSG2_LEN];
+  static int result[NSPEEDBATCH];
+  uint64_t resp_median, end_median;
+  char s[64];
+  unsigned int i;
+
+  for(i=0;i<n;i++) {
+    randombytes(pw[i],CRYPTO_BYTES);
+    randombytes(sid[i],CRYPTO_BYTES);
+    initStart(msg1[i],pk[i],sk[i],pw[i],sid[i]);
+  }
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    resp_batch(key,msg2,(const uint8_t (*)[MSG1_LEN])msg1,
+               (const uint8_t (*)[CRYPTO_BYTES])pw,
+               (const uint8_t (*)[CRYPTO_BYTES])sid,n);
+  }
+  snprintf(s,sizeof(s),"resp_batch (n = %zu): ",n);
+  print_results(s, t, NTESTS);
+  resp_median = t[(NTESTS-1)/2];
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    initEnd_batch(key,result,(const uint8_t (*)[MSG2_LEN])msg2,
+                  (const uint8_t (*)[MSG1_LEN])msg1,
+                  (const uint8_t (*)[CRYPTO_PUBLICKEYBYTES])pk,
+                  (const uint8_t (*)[CRYPTO_SECRETKEYBYTES])sk,
+                  (const uint8_t (*)[CRYPTO_BYTES])sid,n);
+  }
+  snprintf(s,sizeof(s),"initEnd_batch (n = %zu): ",n);
+  print_results(s, t, NTESTS);
+  end_median = t[(NTESTS-1)/2];
+
+  // print_results leaves the cycle counts sorted
+  printf("cycles/handshake (n = %zu): resp %llu, initEnd %llu, both %llu\n\n",n,
+         (unsigned long long)(resp_median/n),(unsigned long long)(end_median/n),
+         (unsigned long long)((resp_median+end_median)/n));
+}
+
+#ifdef PAKE_RANDBUF
+// the getrandom call the Kyber randombytes.c makes for every request
+static void getrandom_bytes(uint8_t *out, size_t outlen)
+{
+  if(syscall(SYS_getrandom, out, outlen, 0) != (long)outlen)
+    exit(1);
+}
+
+// refills are amortized over many calls: compare averages, not medians
+static uint64_t average_cycles(void)
+{
+  uint64_t acc = 0;
+  unsigned int i;
+
+  // print_results leaves NTESTS-1 cycle counts
+  for(i=0;i<NTESTS-1;i++)
+    acc += t[i];
+  return acc/(NTESTS-1);
+}
+
+static void speed_randbuf(void)
+{
+  static const uint8_t seed_speed[KYBER_SYMBYTES] = {0};
+  uint8_t sid[CRYPTO_BYTES] = {0};
+  uint8_t pw[CRYPTO_BYTES] = {0};
+  uint8_t sk[CRYPTO_SECRETKEYBYTES];
+  uint8_t pk[CRYPTO_PUBLICKEYBYTES];
+  uint8_t key[CRYPTO_BYTES];
+  uint8_t msg1[MSG1_LEN];
+  uint8_t msg2[MSG2_LEN];
+  uint8_t buf[KYBER_SYMBYTES];
+  uint64_t calls, syscalls, calls0, syscalls0, os_cycles, buf_cycles;
+  unsigned int i;
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    getrandom_bytes(buf,sizeof(buf));
+  }
+  print_results("getrandom (32 bytes): ", t, NTESTS);
+  os_cycles = average_cycles();
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    randombytes(buf,sizeof(buf));
+  }
+  print_results("randombytes randbuf (32 bytes): ", t, NTESTS);
+  buf_cycles = average_cycles();
+
+  // OS-seeded, as in production
+  randbuf_stats(&calls0,&syscalls0);
+  for(i=0;i<NTESTS;i++) {
+    initStart(msg1,pk,sk,pw,sid);
+    resp(key,msg2,msg1,pw,sid);
+    initEnd(key,msg2,msg1,pk,sk,sid);
+  }
+  randbuf_stats(&calls,&syscalls);
+  calls -= calls0;
+  syscalls -= syscalls0;
+  printf("randombytes calls/handshake: %.2f, getrandom syscalls/handshake: %.4f\n",
+         (double)calls/NTESTS, (double)syscalls/NTESTS);
+  printf("cycles/handshake saved: %.0f\n\n",
+         (double)calls/NTESTS*(double)((int64_t)os_cycles-(int64_t)buf_cycles));
+
+  // the timings below run on a reproducible stream
+  randbuf_seed(seed_speed);
+}
+#endif
+
 int main(void)
 {
   unsigned int i;
@@ -24,9 +185,109 @@ int main(void)
   uint8_t key[CRYPTO_BYTES];
   uint8_t msg1[MSG1_LEN];
   uint8_t msg2[MSG2_LEN];
+  polyvec a[KYBER_K];
+  uint8_t buf[504];
 
+#ifdef PAKE_RANDBUF
+  speed_randbuf();
+#endif
   randombytes(pw,CRYPTO_BYTES);
+  randombytes(buf,sizeof(buf));
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    rej_uniform(a[0].vec[0].coeffs,KYBER_N,buf,sizeof(buf));
+  }
+  print_results("rej_uniform: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    rej_uniform_fast(a[0].vec[0].coeffs,KYBER_N,buf,sizeof(buf));
+  }
+  print_results("rej_uniform_fast: ", t, NTESTS);
+
+  gen_vector(a,seed);
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    polyvec_frombytes(&a[1],pk);
+    polyvec_add(&a[1],&a[1],&a[0]);
+    polyvec_reduce(&a[1]);
+    polyvec_tobytes(pk,&a[1]);
+  }
+  print_results("mask (4 passes): ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    polyvec_mask_add(pk,pk,&a[0]);
+  }
+  print_results("polyvec_mask_add: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_vector(a,seed);
+  }
+  print_results("gen_vector: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_vector_x4(a,seed);
+  }
+  print_results("gen_vector_x4: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_vector_turboshake(a,seed);
+  }
+  print_results("gen_vector_turboshake: ", t, NTESTS);
+
+#ifdef GENAES_VECTOR
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_vector_evp(a,seed);
+  }
+  print_results("gen_vector_evp: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_vector_aes256ctr(a,seed);
+  }
+  print_results("gen_vector_aes256ctr: ", t, NTESTS);
+#endif
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_matrix(a,seed,1);
+  }
+  print_results("gen_matrix: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    gen_matrix_x4(a,seed,1);
+  }
+  print_results("gen_matrix_x4: ", t, NTESTS);
+
+  for(i=0;i<sizeof(hlens)/sizeof(hlens[0]);i++) {
+    speed_hash("sha3_256",sha3_256,hlens[i]);
+    speed_hash("sha3_256_fast",sha3_256_fast,hlens[i]);
+  }
+  for(i=0;i<sizeof(glens)/sizeof(glens[0]);i++) {
+    speed_hash("sha3_512",sha3_512,glens[i]);
+    speed_hash("sha3_512_fast",sha3_512_fast,glens[i]);
+  }
  
+  crypto_kem_keypair(pk,sk);
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    twofeistel_eval(msg1,pk,pw,sid,seed);
+  }
+  print_results("twofeistel_eval: ", t, NTESTS);
+
+  for(i=0;i<NTESTS;i++) {
+    t[i] = cpucycles();
+    twofeistel_inv(pk,msg1,pw,sid);
+  }
+  print_results("twofeistel_inv: ", t, NTESTS);
+
   for(i=0;i<NTESTS;i++) {
     t[i] = cpucycles();
     initStart(msg1,pk,sk,pw,sid);
@@ -45,6 +306,99 @@ int main(void)
   }
   print_results("initEnd: ", t, NTESTS);
 
+  for(i=0;i<sizeof(batchns)/sizeof(batchns[0]);i++)
+    speed_batch(batchns[i]);
+
+#ifdef PAKE_KEYPOOL
+  {
+    struct timespec wait = { 0, 1000000 };
+    keypool *pool = keypool_new(NTESTS);
+    uint64_t hits, misses;
+
+    // time the pool hits only: let the generator fill it first
+    while(pool && keypool_available(pool) < NTESTS)
+      nanosleep(&wait, NULL);
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initStartPool(msg1,pk,sk,pw,sid,pool);
+    }
+    print_results("initStartPool: ", t, NTESTS);
+    if(pool) {
+      keypool_stats(pool,&hits,&misses);
+      printf("keypool hits: %llu misses: %llu\n\n",
+             (unsigned long long)hits, (unsigned long long)misses);
+    }
+    keypool_free(pool);
+  }
+#endif
+
+#ifdef PAKE_TRANSCRIPT_PREFIX
+  {
+    pake_init_state st;
+
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initStartPrefix(msg1,&st,pw,sid);
+    }
+    print_results("initStartPrefix: ", t, NTESTS);
+
+    resp(key,msg2,msg1,pw,sid);
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initEndPrefix(key,msg2,&st);
+    }
+    print_results("initEndPrefix: ", t, NTESTS);
+  }
+#endif
+
+#ifdef PAKE_COMPACT_STATE
+  {
+    pake_compact_state st;
+
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initStartCompact(msg1,&st,pw,sid);
+    }
+    print_results("initStartCompact: ", t, NTESTS);
+
+    resp(key,msg2,msg1,pw,sid);
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initEndCompact(key,msg2,&st,sid);
+    }
+    print_results("initEndCompact: ", t, NTESTS);
+
+    // initiator state kept between the two stages
+    printf("state bytes: initStart %d, initStartCompact %zu\n\n",
+           MSG1_LEN+CRYPTO_PUBLICKEYBYTES+CRYPTO_SECRETKEYBYTES,
+           sizeof(pake_compact_state));
+  }
+#endif
+
+#ifdef PAKE_FAT_STATE
+  {
+    kem_fat_sk fsk;
+
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initStartFat(msg1,pk,&fsk,pw,sid);
+    }
+    print_results("initStartFat: ", t, NTESTS);
+
+    resp(key,msg2,msg1,pw,sid);
+    for(i=0;i<NTESTS;i++) {
+      t[i] = cpucycles();
+      initEndFat(key,msg2,msg1,pk,&fsk,sid);
+    }
+    print_results("initEndFat: ", t, NTESTS);
+
+    // initiator state kept between the two stages
+    printf("state bytes: initStart %d, initStartFat %zu\n\n",
+           MSG1_LEN+CRYPTO_PUBLICKEYBYTES+CRYPTO_SECRETKEYBYTES,
+           MSG1_LEN+CRYPTO_PUBLICKEYBYTES+sizeof(kem_fat_sk));
+  }
+#endif
+
 
   return 0;
 }
@@ -2,9 +2,12 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "params.h"
+#include "genx4.h"
+#include "polymask.h"
 #include "twofeistel.h"
 #include "polyvec.h"
 #include "symmetric.h"
+#include "sha3inc.h"
 #include "rej_uniform.h"
 
 #include <inttypes.h>
@@ -53,7 +56,7 @@ void twofeistel_eval(uint8_t twofc[KYBER_SYMBYTES-KYBER_SYMBYTES+KYBER_PUBLICKEY
   uint8_t hash_in_rl[2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES];
   uint8_t mask_pk_t[KYBER_SYMBYTES];
   uint8_t mask_nonce[KYBER_SYMBYTES];
-  polyvec in_t, mask_t;
+  polyvec mask_t;
 
   uint8_t* twofc_nonce = twofc;
   uint8_t* twofc_t = twofc+KYBER_SYMBYTES;
@@ -65,18 +68,13 @@ void twofeistel_eval(uint8_t twofc[KYBER_SYMBYTES-KYBER_SYMBYTES+KYBER_PUBLICKEY
   memcpy(hin_lr_pw,pw,KYBER_SYMBYTES);
   memcpy(hin_lr_sid,sid,KYBER_SYMBYTES);
   memcpy(hin_lr_nonce,nonce,KYBER_SYMBYTES);
-  hash_h(mask_pk_t,hash_in_lr,3*KYBER_SYMBYTES);
-
-  //unpack vec part of pk
-  polyvec_frombytes(&in_t, pk_t);
+  mask_hash_h(mask_pk_t,hash_in_lr,3*KYBER_SYMBYTES);
 
   // H'(mask_seed_t) -> mask_t
-  gen_vector(&mask_t,mask_pk_t); 
-  polyvec_add(&mask_t,&mask_t,&in_t);
-  polyvec_reduce(&mask_t);
+  pake_gen_vector(&mask_t,mask_pk_t); 
 
-  //pack vec part of masked pk for hashing
-  polyvec_tobytes(twofc_t, &mask_t);
+  //mask vec part of pk, packed for hashing
+  polyvec_mask_add(twofc_t, pk_t, &mask_t);
 
   // G(pw,vecpartpk) -> mask_nonce
   uint8_t *hin_rl_pw = hash_in_rl;
@@ -85,7 +83,7 @@ void twofeistel_eval(uint8_t twofc[KYBER_SYMBYTES-KYBER_SYMBYTES+KYBER_PUBLICKEY
   memcpy(hin_rl_pw,pw,KYBER_SYMBYTES);
   memcpy(hin_rl_sid,sid,KYBER_SYMBYTES);
   memcpy(hin_rl_pk,twofc_t,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
-  hash_h(mask_nonce,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+  mask_hash_h(mask_nonce,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
 
   arrayxor(twofc_nonce,nonce,mask_nonce, KYBER_SYMBYTES);
 
@@ -110,14 +108,18 @@ void twofeistel_inv(uint8_t pk_t[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
               const uint8_t pw[KYBER_SYMBYTES],
               const uint8_t sid[KYBER_SYMBYTES])
 {
-  uint8_t hash_in_lr[3*KYBER_SYMBYTES];
-  uint8_t hash_in_rl[2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES];
-  uint8_t mask_pk_t[KYBER_SYMBYTES];
-  uint8_t mask_nonce[KYBER_SYMBYTES];
-  uint8_t nonce[KYBER_SYMBYTES];
-  polyvec in_t, mask_t;
+  polyvec pkpv;
 
-  const uint8_t* twofc_nonce = twofc;
+  twofeistel_inv_unpacked(pk_t,&pkpv,twofc,pw,sid);
+}
+
+// G(pw,sid,vecpart) -> mask_nonce, straight from twofc
+static void twofeistel_nonce_mask(uint8_t mask_nonce[KYBER_SYMBYTES],
+                                  const uint8_t twofc[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                                  const uint8_t pw[KYBER_SYMBYTES],
+                                  const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t hash_in_rl[2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES];
   const uint8_t* twofc_t = twofc+KYBER_SYMBYTES;
 
   // G(pw,vecpartpk) -> nonce mask
@@ -127,7 +129,62 @@ void twofeistel_inv(uint8_t pk_t[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
   memcpy(hin_rl_pw,pw,KYBER_SYMBYTES);
   memcpy(hin_rl_sid,sid,KYBER_SYMBYTES);
   memcpy(hin_rl_pk,twofc_t,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
-  hash_h(mask_nonce,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+  mask_hash_h(mask_nonce,hash_in_rl,2*KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+}
+
+// twofeistel_nonce_mask for m inputs, four at a time on the four-lane
+// Keccak; unused lanes of a group hash its first input again, and a
+// group of one takes the single-state hash
+static void twofeistel_nonce_mask_xN(uint8_t (*mask_nonce)[KYBER_SYMBYTES],
+                                     const uint8_t (*twofc)[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES],
+                                     const uint8_t (*pw)[KYBER_SYMBYTES],
+                                     const uint8_t (*sid)[KYBER_SYMBYTES],
+                                     size_t m)
+{
+  uint8_t scratch[KYBER_SYMBYTES];
+  const uint8_t *in_pw[4], *in_sid[4], *in_t[4];
+  uint8_t *out[4];
+  keccakx4_state state;
+  size_t i, j;
+  unsigned int l, k;
+
+  for(i=0;i<m;i+=k) {
+    k = m-i < 4 ? m-i : 4;
+    if(k == 1) {
+      twofeistel_nonce_mask(mask_nonce[i],twofc[i],pw[i],sid[i]);
+      continue;
+    }
+    for(l=0;l<4;l++) {
+      j = i + (l < k ? l : 0);
+      in_pw[l] = pw[j];
+      in_sid[l] = sid[j];
+      in_t[l] = twofc[j]+KYBER_SYMBYTES;
+      out[l] = l < k ? mask_nonce[i+l] : scratch;
+    }
+    mask_hash_hx4_init(&state);
+    mask_hash_hx4_absorb(&state,in_pw,KYBER_SYMBYTES);
+    mask_hash_hx4_absorb(&state,in_sid,KYBER_SYMBYTES);
+    mask_hash_hx4_absorb(&state,in_t,KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES);
+    mask_hash_hx4_final(out,&state);
+  }
+}
+
+// everything in twofeistel_inv after the nonce mask G(pw,sid,vecpart):
+// unmasks the nonce and with it the vector part, into pk and pkpv
+static void twofeistel_inv_post(uint8_t pk_t[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                                polyvec *pkpv,
+                                const uint8_t twofc[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                                const uint8_t mask_nonce[KYBER_SYMBYTES],
+                                const uint8_t pw[KYBER_SYMBYTES],
+                                const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t hash_in_lr[3*KYBER_SYMBYTES];
+  uint8_t mask_pk_t[KYBER_SYMBYTES];
+  uint8_t nonce[KYBER_SYMBYTES];
+  polyvec mask_t;
+
+  const uint8_t* twofc_nonce = twofc;
+  const uint8_t* twofc_t = twofc+KYBER_SYMBYTES;
 
   // unmask the nonce
   arrayxor(nonce, twofc_nonce, mask_nonce, KYBER_SYMBYTES);
@@ -139,17 +196,74 @@ void twofeistel_inv(uint8_t pk_t[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
   memcpy(hin_lr_pw,pw,KYBER_SYMBYTES);
   memcpy(hin_lr_sid,sid,KYBER_SYMBYTES);
   memcpy(hin_lr_nonce,nonce,KYBER_SYMBYTES);
-  hash_h(mask_pk_t,hash_in_lr,3*KYBER_SYMBYTES);
-
-  //unpack vec part of pk
-  polyvec_frombytes(&in_t, twofc_t);
+  mask_hash_h(mask_pk_t,hash_in_lr,3*KYBER_SYMBYTES);
 
   // H'(mask_seed_t) -> mask_t
-  gen_vector(&mask_t,mask_pk_t); 
-  polyvec_sub(&mask_t,&in_t,&mask_t);
-  polyvec_reduce(&mask_t);
+  pake_gen_vector(&mask_t,mask_pk_t); 
 
-  //pack_pk and unmask rho
-  polyvec_tobytes(pk_t, &mask_t);
+  //unmask vec part into pk and pkpv
+  polyvec_mask_sub(pk_t, pkpv, twofc_t, &mask_t);
 
 }
+
+/*************************************************
+* Name:        twofeistel_inv_unpacked
+*
+* Description: twofeistel_inv, also returning the vector part of pk
+*              as the polyvec it was packed from
+*
+* Arguments:   - uint8_t *pk_t: pointer to output public key
+*                             (of length KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES bytes)
+*              - polyvec *pkpv: pointer to output vector part of pk
+*              - uint8_t *twofc: pointer to inputciphertext
+*                             (of length KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES+KYBER_SYMBYTES bytes)
+*              - uint8_t *pw: pointer to input password
+*                             (of length KYBER_SYMBYTES bytes)
+*              - uint8_t *sid: pointer to input sid
+*                             (of length KYBER_SYMBYTES bytes)
+**************************************************/
+void twofeistel_inv_unpacked(uint8_t pk_t[KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                             polyvec *pkpv,
+                             const uint8_t twofc[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES-KYBER_SYMBYTES],
+                             const uint8_t pw[KYBER_SYMBYTES],
+                             const uint8_t sid[KYBER_SYMBYTES])
+{
+  uint8_t mask_nonce[KYBER_SYMBYTES];
+
+  twofeistel_nonce_mask(mask_nonce,twofc,pw,sid);
+  twofeistel_inv_post(pk_t,pkpv,twofc,mask_nonce,pw,sid);
+}
+
+/*************************************************
+* Name:        twofeistel_inv_unpacked_xN
+*
+* Description: twofeistel_inv_unpacked for n independent inputs, with
+*              the nonce masks over the vector parts four at a time.
+*              Rows are strided as pk and msg1 (MSG1_LEN) in pake.c
+*
+* Arguments:   - uint8_t (*pk_t): n output public keys, vector part
+*                                 only
+*              - polyvec *pkpv: n output vector parts of pk
+*              - uint8_t (*twofc): n input ciphertexts, each followed
+*                                  by rho
+*              - uint8_t (*pw): n input passwords
+*              - uint8_t (*sid): n input sids
+*              - size_t n: number of inputs
+**************************************************/
+void twofeistel_inv_unpacked_xN(uint8_t (*pk_t)[KYBER_PUBLICKEYBYTES],
+                                polyvec *pkpv,
+                                const uint8_t (*twofc)[KYBER_SYMBYTES+KYBER_PUBLICKEYBYTES],
+                                const uint8_t (*pw)[KYBER_SYMBYTES],
+                                const uint8_t (*sid)[KYBER_SYMBYTES],
+                                size_t n)
+{
+  uint8_t mask_nonce[TWOFEISTEL_BATCH][KYBER_SYMBYTES];
+  size_t i, j, m;
+
+  for(i=0;i<n;i+=m) {
+    m = n-i < TWOFEISTEL_BATCH ? n-i : TWOFEISTEL_BATCH;
+    twofeistel_nonce_mask_xN(mask_nonce,twofc+i,pw+i,sid+i,m);
+    for(j=0;j<m;j++)
+      twofeistel_inv_post(pk_t[i+j],&pkpv[i+j],twofc[i+j],mask_nonce[j],pw[i+j],sid[i+j]);
+  }
+}